@@ -0,0 +1,121 @@
+#include "batch_detector.h"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+
+using namespace std;
+namespace fs = std::filesystem;
+
+vector<string> collectBatchInputs(const string& path) {
+    vector<string> inputs;
+
+    error_code error;
+    if (path != "-" && fs::is_directory(path, error)) {
+        for (fs::recursive_directory_iterator it(path, error), end; !error && it != end; it.increment(error)) {
+            if (it->is_regular_file(error)) inputs.push_back(it->path().string());
+        }
+        if (error) cerr << "Error: Could not list " << path << ": " << error.message() << "\n";
+        sort(inputs.begin(), inputs.end());
+        return inputs;
+    }
+
+    ifstream listFile;
+    if (path != "-") {
+        listFile.open(path);
+        if (!listFile.is_open()) {
+            cerr << "Error: Could not open file " << path << "\n";
+            return inputs;
+        }
+    }
+    istream& list = (path == "-") ? cin : listFile;
+
+    string line;
+    while (getline(list, line)) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (!line.empty()) inputs.push_back(line);
+    }
+    return inputs;
+}
+
+namespace {
+
+// One slot per document; workers fill them in any order and the calling
+// thread drains them in input order
+struct BatchSlot {
+    bool done = false;
+    bool readOk = false;
+    size_t bytes = 0;
+    unique_ptr<DetectionResult> result;
+};
+
+// Streams the file through a detector, stopping early if it says so
+bool detectFile(const string& path, const DictionaryImage& dictionary, const DetectionOptions& options,
+                BatchSlot& slot) {
+    ifstream file(path, ios::binary);
+    if (!file.is_open()) return false;
+
+    // The buffer is reused, so spans into it would be meaningless
+    DetectionOptions fileOptions = options;
+    fileOptions.recordContributors = false;
+    StreamingDetector detector(dictionary, fileOptions);
+    vector<char> buffer(64 * 1024);
+    while (file && !detector.done()) {
+        file.read(buffer.data(), static_cast<streamsize>(buffer.size()));
+        size_t got = static_cast<size_t>(file.gcount());
+        slot.bytes += got;
+        detector.feed(string_view(buffer.data(), got));
+    }
+    slot.result.reset(new DetectionResult(detector.finish()));
+    return true;
+}
+
+} // namespace
+
+BatchStats detectBatch(const vector<string>& paths, const DictionaryImage& dictionary,
+                       const DetectionOptions& options, ThreadPool& pool, const BatchCallback& emit) {
+    BatchStats stats;
+    auto start = chrono::steady_clock::now();
+
+    vector<BatchSlot> slots(paths.size());
+    mutex slotsMutex;
+    condition_variable slotReady;
+
+    for (size_t i = 0; i < paths.size(); ++i) {
+        pool.submit([&, i] {
+            BatchSlot filled;
+            filled.readOk = detectFile(paths[i], dictionary, options, filled);
+            filled.done = true;
+
+            lock_guard<mutex> lock(slotsMutex);
+            slots[i] = move(filled);
+            slotReady.notify_one();
+        });
+    }
+
+    // Emit in input order while later documents are still being processed
+    for (size_t next = 0; next < paths.size(); ++next) {
+        BatchSlot slot;
+        {
+            unique_lock<mutex> lock(slotsMutex);
+            slotReady.wait(lock, [&] { return slots[next].done; });
+            slot = move(slots[next]);
+        }
+
+        ++stats.documents;
+        if (!slot.readOk) {
+            ++stats.failed;
+            cerr << "Error: Could not open file " << paths[next] << "\n";
+        }
+        stats.bytes += slot.bytes;
+        emit(next, paths[next], slot.result.get());
+    }
+
+    pool.wait();
+    stats.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    return stats;
+}
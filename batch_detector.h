@@ -0,0 +1,38 @@
+#ifndef BATCH_DETECTOR_H
+#define BATCH_DETECTOR_H
+
+#include <functional>
+#include <string>
+#include <vector>
+#include "language_detector.h"
+#include "thread_pool.h"
+
+// Totals for one batch run
+struct BatchStats {
+    size_t documents = 0;
+    size_t failed = 0;       // files that could not be read
+    size_t bytes = 0;        // bytes read, which early exit can cut short
+    double seconds = 0.0;
+
+    double documentsPerSecond() const { return seconds > 0 ? documents / seconds : 0.0; }
+    double megabytesPerSecond() const { return seconds > 0 ? bytes / seconds / 1e6 : 0.0; }
+};
+
+// Expands a batch argument into the documents to process: every regular file
+// under a directory (recursively, sorted by path), or the paths listed one
+// per line in a file ("-" reads the list from stdin).
+std::vector<std::string> collectBatchInputs(const std::string& path);
+
+// Called once per document, on the calling thread and in input order.
+// `result` is nullptr when the file could not be read.
+using BatchCallback = std::function<void(size_t index, const std::string& path,
+                                         const DetectionResult* result)>;
+
+// Detects every file on the pool, sharing the read-only dictionary between
+// workers, and hands results to `emit` in the order of `paths` as soon as
+// each prefix is complete. Files are streamed in chunks, so with early exit
+// only the part needed for a decision is read.
+BatchStats detectBatch(const std::vector<std::string>& paths, const DictionaryImage& dictionary,
+                       const DetectionOptions& options, ThreadPool& pool, const BatchCallback& emit);
+
+#endif
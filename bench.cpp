@@ -0,0 +1,309 @@
+#include "json_util.h"
+#include "language_detector.h"
+#include "language_trie.h"
+#include "normalize.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+// ────────────────────────────────
+// Allocation counting: every operator new in the process goes through here
+// ────────────────────────────────
+static atomic<size_t> allocationCount{0};
+
+void* operator new(size_t size) {
+    allocationCount.fetch_add(1, memory_order_relaxed);
+    if (void* memory = malloc(size ? size : 1)) return memory;
+    throw bad_alloc();
+}
+void* operator new[](size_t size) { return operator new(size); }
+void operator delete(void* memory) noexcept { free(memory); }
+void operator delete[](void* memory) noexcept { operator delete(memory); }
+void operator delete(void* memory, size_t) noexcept { operator delete(memory); }
+void operator delete[](void* memory, size_t) noexcept { operator delete(memory); }
+
+// SplitMix64, so corpora are identical on every platform and standard library
+struct Random {
+    uint64_t state;
+    explicit Random(uint64_t seed) : state(seed) {}
+    uint64_t next() {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+    size_t below(size_t bound) { return static_cast<size_t>(next() % bound); }
+};
+
+struct BenchResult {
+    string name;
+    size_t ops = 0;             // operations per pass
+    size_t bytes = 0;           // input bytes per pass
+    double seconds = 0.0;       // total over all passes
+    size_t passes = 0;
+    size_t allocations = 0;     // total over all passes
+    vector<double> sampleNs;    // per-operation time of each sample
+
+    double nsPerOp() const { return ops ? seconds * 1e9 / (double(ops) * passes) : 0.0; }
+    double megabytesPerSecond() const { return seconds > 0 ? double(bytes) * passes / seconds / 1e6 : 0.0; }
+    double allocationsPerOp() const { return ops ? double(allocations) / (double(ops) * passes) : 0.0; }
+
+    double percentile(double p) const {
+        if (sampleNs.empty()) return 0.0;
+        vector<double> sorted = sampleNs;
+        sort(sorted.begin(), sorted.end());
+        size_t index = static_cast<size_t>(p * (sorted.size() - 1) + 0.5);
+        return sorted[index];
+    }
+};
+
+struct BenchOptions {
+    string dictDir;
+    size_t passes = 5;
+    string filter;
+};
+
+// Runs `body` once to warm up, then `passes` times. `body` processes the whole
+// corpus and appends one per-operation latency per sample it takes.
+static BenchResult runBench(const string& name, size_t ops, size_t bytes, const BenchOptions& options,
+                            const function<void(vector<double>& samples)>& body) {
+    BenchResult result;
+    result.name = name;
+    result.ops = ops;
+    result.bytes = bytes;
+
+    vector<double> warmup;
+    body(warmup);
+
+    for (size_t pass = 0; pass < options.passes; ++pass) {
+        size_t allocationsBefore = allocationCount.load(memory_order_relaxed);
+        auto start = chrono::steady_clock::now();
+        body(result.sampleNs);
+        result.seconds += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        result.allocations += allocationCount.load(memory_order_relaxed) - allocationsBefore;
+        ++result.passes;
+    }
+    return result;
+}
+
+// Times `op` over the items in batches and records the per-item time of each
+// batch; single calls are too short to time on their own
+template <typename Item, typename Op>
+static void timeBatches(const vector<Item>& items, size_t batch, vector<double>& samples, Op op) {
+    for (size_t begin = 0; begin < items.size(); begin += batch) {
+        size_t end = min(items.size(), begin + batch);
+        auto start = chrono::steady_clock::now();
+        for (size_t i = begin; i < end; ++i) op(items[i]);
+        double ns = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count();
+        samples.push_back(ns / double(end - begin));
+    }
+}
+
+static size_t totalBytes(const vector<string>& items) {
+    size_t bytes = 0;
+    for (const string& item : items) bytes += item.size();
+    return bytes;
+}
+
+// Keeps the optimizer from dropping benchmarked calls
+static atomic<size_t> sink{0};
+
+static void printUsage(const char* program) {
+    cerr << "Usage: " << program << " [options]\n"
+         << "\n"
+         << "Times dictionary loading, normalization, trie lookups and end-to-end\n"
+         << "detection on fixed corpora. Prints a table on stderr and JSON on stdout.\n"
+         << "\n"
+         << "Options:\n"
+         << "  --dict-dir DIR   data directory (default: " << findDataDirectory(program) << ")\n"
+         << "  --passes N       timed passes per benchmark (default: 5)\n"
+         << "  --filter TEXT    only run benchmarks whose name contains TEXT\n"
+         << "  -h, --help       show this help\n";
+}
+
+int main(int argc, char** argv) {
+    BenchOptions options;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "-h" || arg == "--help") {
+            printUsage(argv[0]);
+            return 0;
+        } else if (arg == "--dict-dir" && i + 1 < argc) {
+            options.dictDir = argv[++i];
+        } else if (arg == "--passes" && i + 1 < argc) {
+            options.passes = max<size_t>(1, strtoul(argv[++i], nullptr, 10));
+        } else if (arg == "--filter" && i + 1 < argc) {
+            options.filter = argv[++i];
+        } else {
+            cerr << "Error: Unknown argument " << arg << "\n";
+            printUsage(argv[0]);
+            return 2;
+        }
+    }
+    if (options.dictDir.empty()) options.dictDir = findDataDirectory(argv[0]);
+
+    // ────────────────────────────────
+    // Corpora
+    // ────────────────────────────────
+    vector<LanguageSource> languages;
+    if (!discoverLanguages(options.dictDir, &languages)) return 1;
+
+    vector<vector<string>> wordLists;
+    for (const LanguageSource& language : languages) {
+        ifstream file(language.wordList);
+        if (!file.is_open()) {
+            cerr << "Error: Could not open file " << language.wordList << "\n";
+            return 1;
+        }
+        vector<string> words;
+        string word;
+        while (getline(file, word)) {
+            if (!word.empty() && word.back() == '\r') word.pop_back();
+            if (!word.empty()) words.push_back(word);
+        }
+        wordLists.push_back(move(words));
+    }
+
+    Random random(42);
+
+    // 50k words drawn from every list, as typed (case and accents kept)
+    vector<string> queryWords;
+    for (size_t i = 0; i < 50000; ++i) {
+        const vector<string>& list = wordLists[random.below(wordLists.size())];
+        if (!list.empty()) queryWords.push_back(list[random.below(list.size())]);
+    }
+
+    // 40 synthetic documents per language: 200 dictionary words each, with a
+    // one-letter typo in every 20th word and a made-up word in every 25th
+    vector<string> syntheticDocs;
+    for (const vector<string>& list : wordLists) {
+        if (list.empty()) continue;
+        for (size_t doc = 0; doc < 40; ++doc) {
+            string text;
+            for (size_t w = 0; w < 200; ++w) {
+                string word = list[random.below(list.size())];
+                if (random.below(20) == 0 && word.size() > 3) word[random.below(word.size())] = 'a' + random.below(26);
+                if (random.below(25) == 0) {
+                    word.clear();
+                    for (size_t k = 0, length = 4 + random.below(6); k < length; ++k) word += char('a' + random.below(26));
+                }
+                text += word;
+                text += (w % 15 == 14) ? ". " : " ";
+            }
+            syntheticDocs.push_back(move(text));
+        }
+    }
+
+    // Every word list cut into 500-word documents
+    vector<string> wordListDocs;
+    for (const vector<string>& list : wordLists) {
+        for (size_t begin = 0; begin < list.size(); begin += 500) {
+            string text;
+            for (size_t i = begin; i < min(list.size(), begin + 500); ++i) text += list[i] + "\n";
+            wordListDocs.push_back(move(text));
+        }
+    }
+
+    // ────────────────────────────────
+    // Benchmarks
+    // ────────────────────────────────
+    vector<BenchResult> results;
+    auto wanted = [&](const string& name) {
+        return options.filter.empty() || name.find(options.filter) != string::npos;
+    };
+
+    if (wanted("load/word_lists")) {
+        size_t bytes = 0;
+        for (const vector<string>& list : wordLists) bytes += totalBytes(list) + list.size();
+        results.push_back(runBench("load/word_lists", 1, bytes, options, [&](vector<double>& samples) {
+            auto start = chrono::steady_clock::now();
+            DictionaryImage image;
+            buildDictionary(&image, options.dictDir);
+            sink += image.nodeCount();
+            samples.push_back(chrono::duration<double, nano>(chrono::steady_clock::now() - start).count());
+        }));
+    }
+
+    DictionaryImage dictionary;
+    if (!buildDictionary(&dictionary, options.dictDir)) return 1;
+
+    if (wanted("load/image_attach")) {
+        MultiLanguageTrie trie;
+        loadLanguages(&trie, languages);
+        vector<uint8_t> bytes = DictionaryImage::compile(trie);
+        results.push_back(runBench("load/image_attach", 1, bytes.size(), options, [&](vector<double>& samples) {
+            auto start = chrono::steady_clock::now();
+            DictionaryImage image;
+            image.attach(bytes.data(), bytes.size());
+            sink += image.nodeCount();
+            samples.push_back(chrono::duration<double, nano>(chrono::steady_clock::now() - start).count());
+        }));
+    }
+
+    if (wanted("normalize_word")) {
+        results.push_back(runBench("normalize_word", queryWords.size(), totalBytes(queryWords), options,
+            [&](vector<double>& samples) {
+                timeBatches(queryWords, 1024, samples, [](const string& word) { sink += normalizeWord(word).size(); });
+            }));
+    }
+
+    if (wanted("language_trie/get_match_score")) {
+        LanguageTrie english(languages[0].name);
+        for (const string& word : wordLists[0]) english.insert(word);
+        results.push_back(runBench("language_trie/get_match_score", queryWords.size(), totalBytes(queryWords),
+            options, [&](vector<double>& samples) {
+                timeBatches(queryWords, 1024, samples, [&](const string& word) { sink += english.getMatchScore(word); });
+            }));
+    }
+
+    NgramProfile ngrams;
+    ngrams.build(dictionary);
+    DetectionOptions detection;
+    detection.ngrams = &ngrams;
+
+    auto detectBench = [&](const string& name, const vector<string>& docs) {
+        if (!wanted(name)) return;
+        results.push_back(runBench(name, docs.size(), totalBytes(docs), options, [&](vector<double>& samples) {
+            timeBatches(docs, 1, samples, [&](const string& doc) {
+                sink += detectLanguageWithMatrix(doc, dictionary, detection).tokensConsumed;
+            });
+        }));
+    };
+    detectBench("detect/synthetic", syntheticDocs);
+    detectBench("detect/word_lists", wordListDocs);
+
+    // ────────────────────────────────
+    // Report
+    // ────────────────────────────────
+    cerr << left << setw(32) << "benchmark" << right << setw(14) << "ns/op" << setw(12) << "MB/s"
+         << setw(12) << "allocs/op" << setw(14) << "p50 ns" << setw(14) << "p99 ns" << "\n";
+    for (const BenchResult& r : results) {
+        cerr << left << setw(32) << r.name << right << fixed << setprecision(1) << setw(14) << r.nsPerOp()
+             << setw(12) << r.megabytesPerSecond() << setprecision(2) << setw(12) << r.allocationsPerOp()
+             << setprecision(1) << setw(14) << r.percentile(0.5) << setw(14) << r.percentile(0.99) << "\n";
+    }
+
+    cout << "{\"languages\":" << languages.size() << ",\"passes\":" << options.passes
+         << ",\"hardware_threads\":" << thread::hardware_concurrency() << ",\"benchmarks\":[";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const BenchResult& r = results[i];
+        if (i) cout << ",";
+        cout << "{\"name\":\"" << jsonEscape(r.name) << "\",\"ops\":" << r.ops << ",\"bytes\":" << r.bytes
+             << ",\"ns_per_op\":" << r.nsPerOp() << ",\"mb_per_s\":" << r.megabytesPerSecond()
+             << ",\"allocs_per_op\":" << r.allocationsPerOp() << ",\"p50_ns\":" << r.percentile(0.5)
+             << ",\"p99_ns\":" << r.percentile(0.99) << "}";
+    }
+    cout << "]}\n";
+    return 0;
+}
@@ -0,0 +1,258 @@
+#include "batch_detector.h"
+#include "embedded_dictionary.h"
+#include "json_util.h"
+#include "language_detector.h"
+#include "segmenter.h"
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+static void printUsage(const char* program) {
+    cerr << "Usage: " << program << " [options] [file...]\n"
+         << "\n"
+         << "Detects the language of each file (or of stdin when no file, or \"-\", is given)\n"
+         << "and prints one JSON result per line.\n"
+         << "\n"
+         << "Options:\n"
+         << "  --dict-dir DIR   directory holding languages.manifest or *.txt word lists\n"
+         << "                   (default: $LANGWITCH_DATA_DIR or a manifest next to the\n"
+         << "                   program, else the dictionary built into the program)\n"
+         << "  --dictionary F   use an image built by langwitch-compile instead\n"
+         << "  --lines          treat every input line as a separate document\n"
+         << "  --batch PATH     detect every file under directory PATH, or every file\n"
+         << "                   listed one per line in PATH (\"-\" for stdin), in\n"
+         << "                   parallel; results keep the input order (each file is\n"
+         << "                   one document, so not with --lines, --segment or\n"
+         << "                   file arguments)\n"
+         << "  --threads N      worker threads for --batch (default: all cores)\n"
+         << "  --segment        split each input into spans of one language and print one\n"
+         << "                   JSON line per span, with byte offsets\n"
+         << "  --window N       words each --segment label is decided from (default: 16)\n"
+         << "  --min-span N     shortest change of language --segment reports, in words\n"
+         << "                   (default: 4)\n"
+         << "  --matrix         include the word match matrix in each result\n"
+         << "  --early-exit     stop reading a document once its language is clear\n"
+         << "  --min-tokens N   words to read before early exit may trigger (default: 50)\n"
+         << "  --target-confidence X\n"
+         << "                   confidence the leader must reach for early exit (0-1)\n"
+         << "  --margin Z       standard deviations the leader must lead by (default: 3)\n"
+         << "  --max-edits N    typos tolerated in unknown words, 0-2 (default: 2)\n"
+         << "  --no-ngrams      do not guess unknown words from their letter n-grams\n"
+         << "  --cache N        cache the matches of N recent distinct words, shared by\n"
+         << "                   all threads; the hit rate is reported on stderr\n"
+         << "  --stats          print per-stage timings and dictionary sizes as JSON on\n"
+         << "                   stderr (timings need a -DLANGWITCH_STATS=ON build)\n"
+         << "  -h, --help       show this help\n";
+}
+
+struct CliOptions {
+    string dictDir;
+    string imagePath;
+    bool perLine = false;
+    bool segment = false;
+    SegmentOptions segmentation;
+    bool includeMatrix = false;
+    bool useNgrams = true;
+    DetectionOptions detection;
+    string batchPath;
+    size_t threads = 0;
+    size_t cacheSlots = 0;
+    bool printStats = false;
+    vector<string> inputs;
+};
+
+static void detectAndPrint(const string& text, const DictionaryImage& dictionary,
+                           const CliOptions& options, const string& source) {
+    DetectionResult result = detectLanguageWithMatrix(text, dictionary, options.detection);
+    writeResultJson(cout, result, options.includeMatrix, source);
+    cout << "\n";
+}
+
+// Segmentation mode: one JSON line per language span, printed as soon as
+// the span is final so any size of input streams through
+static void segmentStream(istream& in, const string& name, const DictionaryImage& dictionary,
+                          const CliOptions& options) {
+    Segmenter segmenter(dictionary, options.detection, options.segmentation, [&](const LanguageSpan& span) {
+        string language = span.language < 0 ? "Unknown"
+                                             : string(dictionary.getLanguageName(static_cast<size_t>(span.language)));
+        cout << "{\"source\":\"" << jsonEscape(name) << "\",\"begin\":" << span.begin << ",\"end\":" << span.end
+             << ",\"language\":\"" << jsonEscape(language) << "\",\"tokens\":" << span.tokens << "}\n";
+    });
+    vector<char> buffer(64 * 1024);
+    while (in) {
+        in.read(buffer.data(), static_cast<streamsize>(buffer.size()));
+        segmenter.feed(string_view(buffer.data(), static_cast<size_t>(in.gcount())));
+    }
+    segmenter.finish();
+}
+
+// Runs detection over one input stream, either as a whole or line by line
+static void processStream(istream& in, const string& name, const DictionaryImage& dictionary,
+                          const CliOptions& options) {
+    if (options.segment) {
+        segmentStream(in, name, dictionary, options);
+        return;
+    }
+    if (options.perLine) {
+        string line;
+        size_t lineNumber = 0;
+        while (getline(in, line)) {
+            ++lineNumber;
+            detectAndPrint(line, dictionary, options, name + ":" + to_string(lineNumber));
+        }
+        return;
+    }
+
+    // Feed the document in chunks so early exit can stop reading it
+    StreamingDetector detector(dictionary, options.detection);
+    vector<char> buffer(64 * 1024);
+    while (in && !detector.done()) {
+        in.read(buffer.data(), static_cast<streamsize>(buffer.size()));
+        detector.feed(string_view(buffer.data(), static_cast<size_t>(in.gcount())));
+    }
+    writeResultJson(cout, detector.finish(), options.includeMatrix, name);
+    cout << "\n";
+}
+
+// Batch mode: parallel detection over many files, followed by a throughput
+// summary on stderr
+static int runBatch(const DictionaryImage& dictionary, const CliOptions& options) {
+    vector<string> paths = collectBatchInputs(options.batchPath);
+    ThreadPool pool(options.threads);
+
+    BatchStats stats = detectBatch(paths, dictionary, options.detection, pool,
+        [&](size_t, const string& path, const DetectionResult* result) {
+            if (result) {
+                writeResultJson(cout, *result, options.includeMatrix, path);
+            } else {
+                cout << "{\"source\":\"" << jsonEscape(path) << "\",\"error\":\"could not read file\"}";
+            }
+            cout << "\n";
+        });
+    cout.flush();
+
+    cerr << "Processed " << stats.documents << " documents (" << stats.failed << " failed), "
+         << stats.bytes << " bytes in " << stats.seconds << " s on " << pool.threadCount()
+         << " threads: " << stats.documentsPerSecond() << " docs/s, "
+         << stats.megabytesPerSecond() << " MB/s\n";
+    return stats.failed ? 1 : 0;
+}
+
+static int processInputs(const DictionaryImage& dictionary, const CliOptions& options) {
+    int status = 0;
+    for (const string& input : options.inputs) {
+        if (input == "-") {
+            processStream(cin, "-", dictionary, options);
+            continue;
+        }
+
+        ifstream file(input, ios::binary);
+        if (!file.is_open()) {
+            cerr << "Error: Could not open file " << input << "\n";
+            status = 1;
+            continue;
+        }
+        processStream(file, input, dictionary, options);
+    }
+    return status;
+}
+
+int main(int argc, char** argv) {
+    CliOptions options;
+    options.detection.recordContributors = false;  // JSON output never lists words
+
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "-h" || arg == "--help") {
+            printUsage(argv[0]);
+            return 0;
+        } else if (arg == "--dict-dir" && i + 1 < argc) {
+            options.dictDir = argv[++i];
+        } else if (arg == "--dictionary" && i + 1 < argc) {
+            options.imagePath = argv[++i];
+        } else if (arg == "--lines") {
+            options.perLine = true;
+        } else if (arg == "--segment") {
+            options.segment = true;
+        } else if (arg == "--window" && i + 1 < argc) {
+            options.segmentation.window = static_cast<size_t>(strtoul(argv[++i], nullptr, 10));
+        } else if (arg == "--min-span" && i + 1 < argc) {
+            options.segmentation.minSpanTokens = static_cast<size_t>(strtoul(argv[++i], nullptr, 10));
+        } else if (arg == "--batch" && i + 1 < argc) {
+            options.batchPath = argv[++i];
+        } else if (arg == "--threads" && i + 1 < argc) {
+            options.threads = static_cast<size_t>(strtoul(argv[++i], nullptr, 10));
+        } else if (arg == "--matrix") {
+            options.includeMatrix = true;
+        } else if (arg == "--early-exit") {
+            options.detection.earlyExit = true;
+        } else if (arg == "--min-tokens" && i + 1 < argc) {
+            options.detection.minTokens = static_cast<size_t>(strtoul(argv[++i], nullptr, 10));
+        } else if (arg == "--target-confidence" && i + 1 < argc) {
+            options.detection.targetConfidence = strtod(argv[++i], nullptr);
+        } else if (arg == "--margin" && i + 1 < argc) {
+            options.detection.marginZ = strtod(argv[++i], nullptr);
+        } else if (arg == "--max-edits" && i + 1 < argc) {
+            options.detection.maxEditDistance = static_cast<unsigned>(strtoul(argv[++i], nullptr, 10));
+        } else if (arg == "--cache" && i + 1 < argc) {
+            options.cacheSlots = static_cast<size_t>(strtoul(argv[++i], nullptr, 10));
+        } else if (arg == "--stats") {
+            options.printStats = true;
+        } else if (arg == "--no-ngrams") {
+            options.useNgrams = false;
+        } else if (arg.size() > 1 && arg[0] == '-') {
+            cerr << "Error: Unknown option " << arg << "\n";
+            printUsage(argv[0]);
+            return 2;
+        } else {
+            options.inputs.push_back(arg);
+        }
+    }
+    // Batch mode detects each file as one document, and takes its files
+    // from PATH only
+    if (!options.batchPath.empty() && (options.perLine || options.segment || !options.inputs.empty())) {
+        cerr << "Error: --batch cannot be combined with "
+             << (options.segment ? "--segment" : options.perLine ? "--lines" : "file arguments") << "\n";
+        printUsage(argv[0]);
+        return 2;
+    }
+    if (options.inputs.empty()) options.inputs.push_back("-");
+
+    DictionaryImage dictionary;
+    string overrideDir;
+    if (!options.imagePath.empty()) {
+        if (!dictionary.openFile(options.imagePath)) return 1;
+    } else if (options.dictDir.empty()) {
+        if (!loadDefaultDictionary(&dictionary, argv[0], &overrideDir)) return 1;
+    } else if (!buildDictionary(&dictionary, options.dictDir)) {
+        cerr << "Error: Could not load dictionaries from " << options.dictDir << "\n";
+        return 1;
+    }
+
+    NgramProfile ngrams;
+    if (options.useNgrams && ngrams.build(dictionary)) options.detection.ngrams = &ngrams;
+
+    unique_ptr<WordCache> cache;
+    if (options.cacheSlots) {
+        cache.reset(new WordCache(options.cacheSlots));
+        options.detection.cache = cache.get();
+    }
+
+    int status = options.batchPath.empty() ? processInputs(dictionary, options) : runBatch(dictionary, options);
+    if (cache) {
+        cerr << "Word cache: " << cache->hits() << " hits, " << cache->misses() << " misses ("
+             << cache->hitRate() * 100 << "% hit rate, " << cache->capacity() << " slots)\n";
+    }
+    if (options.printStats) {
+        detection_stats::Snapshot stats = detection_stats::snapshot(&dictionary);
+        if (!stats.enabled) cerr << "Warning: built without LANGWITCH_STATS, only dictionary sizes are reported\n";
+        detection_stats::writeJson(cerr, stats);
+        cerr << "\n";
+    }
+    return status;
+}
@@ -0,0 +1,116 @@
+#include "language_detector.h"
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+static void printUsage(const char* program) {
+    cerr << "Usage: " << program << " [--dict-dir DIR] [--cpp] -o OUTPUT\n"
+         << "\n"
+         << "Compiles the word lists of a data directory into a dictionary image that\n"
+         << "langwitch-cli --dictionary can memory-map at startup.\n"
+         << "\n"
+         << "Options:\n"
+         << "  --dict-dir DIR   directory holding languages.manifest or *.txt word lists\n"
+         << "                   (default: " << findDataDirectory(program) << ")\n"
+         << "  --cpp            write a C++ source defining the image as constant data\n"
+         << "                   for embedded_dictionary.h instead of an image file\n"
+         << "  -o OUTPUT        image file to write\n";
+}
+
+// Writes the image as the definitions embedded_dictionary.h declares. The
+// bytes are emitted as 64-bit words, which keeps the generated source small
+// and the array 8-byte aligned as DictionaryImage::attach requires; words
+// are read in the byte order of this machine, the one the image is for.
+static bool writeCppSource(const string& path, const vector<uint8_t>& image, const string& dictDir) {
+    ofstream out(path, ios::trunc);
+    out << "// Generated by langwitch-compile --cpp from the word lists in\n"
+        << "// " << dictDir << ". Do not edit.\n"
+        << "#include \"embedded_dictionary.h\"\n"
+        << "\n"
+        << "const uint64_t LANGWITCH_EMBEDDED_DICTIONARY[] = {\n";
+
+    out << hex << setfill('0');
+    size_t words = (image.size() + 7) / 8;
+    for (size_t i = 0; i < words; ++i) {
+        uint64_t word = 0;
+        memcpy(&word, image.data() + i * 8, min<size_t>(8, image.size() - i * 8));
+        out << (i % 4 == 0 ? "    " : " ") << "0x" << setw(16) << word << "ULL,";
+        if (i % 4 == 3 || i + 1 == words) out << "\n";
+    }
+    out << dec << "};\n"
+        << "\n"
+        << "const size_t LANGWITCH_EMBEDDED_DICTIONARY_SIZE = " << image.size() << ";\n";
+    out.close();
+    return static_cast<bool>(out);
+}
+
+int main(int argc, char** argv) {
+    string dictDir;
+    string outputPath;
+    bool cppSource = false;
+
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "-h" || arg == "--help") {
+            printUsage(argv[0]);
+            return 0;
+        } else if (arg == "--dict-dir" && i + 1 < argc) {
+            dictDir = argv[++i];
+        } else if (arg == "--cpp") {
+            cppSource = true;
+        } else if (arg == "-o" && i + 1 < argc) {
+            outputPath = argv[++i];
+        } else {
+            cerr << "Error: Unknown argument " << arg << "\n";
+            printUsage(argv[0]);
+            return 2;
+        }
+    }
+    if (outputPath.empty()) {
+        printUsage(argv[0]);
+        return 2;
+    }
+
+    auto start = chrono::steady_clock::now();
+
+    if (dictDir.empty()) dictDir = findDataDirectory(argv[0]);
+    vector<LanguageSource> languages;
+    if (!discoverLanguages(dictDir, &languages)) return 1;
+
+    MultiLanguageTrie trie;
+    if (!loadLanguages(&trie, languages)) {
+        cerr << "Error: Could not load dictionaries from " << dictDir << "\n";
+        return 1;
+    }
+    size_t trieNodes = trie.nodeCount();
+    vector<uint8_t> image = DictionaryImage::compile(trie);
+
+    bool written;
+    if (cppSource) {
+        written = writeCppSource(outputPath, image, dictDir);
+    } else {
+        ofstream out(outputPath, ios::binary | ios::trunc);
+        out.write(reinterpret_cast<const char*>(image.data()), static_cast<streamsize>(image.size()));
+        out.close();
+        written = static_cast<bool>(out);
+    }
+    if (!written) {
+        cerr << "Error: Could not write " << outputPath << "\n";
+        return 1;
+    }
+
+    DictionaryImage check;
+    if (!check.loadFromBuffer(move(image))) return 1;
+
+    double elapsed = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    cerr << "Wrote " << outputPath << ": " << check.languageCount() << " languages, "
+         << trieNodes << " trie nodes minimized to " << check.nodeCount() << " nodes and "
+         << check.edgeCount() << " edges, " << check.sizeBytes() << " bytes in "
+         << elapsed << " ms\n";
+    return 0;
+}
@@ -0,0 +1,145 @@
+#include "detection_stats.h"
+#include "dictionary_image.h"
+#include "json_util.h"
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+
+using namespace std;
+
+namespace detection_stats {
+
+const char* stageName(Stage stage) {
+    static const char* const names[STAGE_COUNT] = {
+        "tokenize", "normalize", "lookup", "fuzzy", "ngram", "matrix",
+    };
+    return stage < STAGE_COUNT ? names[stage] : "unknown";
+}
+
+#if defined(LANGWITCH_ENABLE_STATS)
+
+namespace {
+
+struct Totals {
+    atomic<uint64_t> documents{0};
+    atomic<uint64_t> bytes{0};
+    atomic<uint64_t> tokens{0};
+    atomic<uint64_t> stageCalls[STAGE_COUNT] = {};
+    atomic<uint64_t> stageTicks[STAGE_COUNT] = {};
+};
+
+Totals totals;
+mutex languageMutex;
+vector<LanguageLoad> languageLoads;
+
+// Ticks and wall time at startup, to convert ticks to seconds
+const uint64_t startTicks = ticks();
+const chrono::steady_clock::time_point startTime = chrono::steady_clock::now();
+
+double secondsPerTick() {
+    // The rate is measured over the process lifetime; make sure that is
+    // long enough to be accurate
+    auto minimum = chrono::milliseconds(5);
+    while (chrono::steady_clock::now() - startTime < minimum) this_thread::yield();
+    double elapsed = chrono::duration<double>(chrono::steady_clock::now() - startTime).count();
+    uint64_t elapsedTicks = ticks() - startTicks;
+    return elapsedTicks ? elapsed / elapsedTicks : 0.0;
+}
+
+} // namespace
+
+void flush(const Counters& counters) {
+    totals.documents.fetch_add(counters.documents, memory_order_relaxed);
+    totals.bytes.fetch_add(counters.bytes, memory_order_relaxed);
+    totals.tokens.fetch_add(counters.tokens, memory_order_relaxed);
+    for (int stage = 0; stage < STAGE_COUNT; ++stage) {
+        totals.stageCalls[stage].fetch_add(counters.stageCalls[stage], memory_order_relaxed);
+        totals.stageTicks[stage].fetch_add(counters.stageTicks[stage], memory_order_relaxed);
+    }
+}
+
+void recordLanguageLoad(const LanguageLoad& load) {
+    lock_guard<mutex> lock(languageMutex);
+    languageLoads.push_back(load);
+}
+
+Snapshot snapshot(const DictionaryImage* dictionary) {
+    Snapshot result;
+    result.enabled = true;
+    result.totals.documents = totals.documents.load(memory_order_relaxed);
+    result.totals.bytes = totals.bytes.load(memory_order_relaxed);
+    result.totals.tokens = totals.tokens.load(memory_order_relaxed);
+    double tickSeconds = secondsPerTick();
+    for (int stage = 0; stage < STAGE_COUNT; ++stage) {
+        result.totals.stageCalls[stage] = totals.stageCalls[stage].load(memory_order_relaxed);
+        result.totals.stageTicks[stage] = totals.stageTicks[stage].load(memory_order_relaxed);
+        result.stageSeconds[stage] = result.totals.stageTicks[stage] * tickSeconds;
+    }
+    {
+        lock_guard<mutex> lock(languageMutex);
+        result.languages = languageLoads;
+    }
+    if (dictionary) {
+        result.imageNodes = dictionary->nodeCount();
+        result.imageEdges = dictionary->edgeCount();
+        result.imageBytes = dictionary->sizeBytes();
+    }
+    return result;
+}
+
+void reset() {
+    totals.documents = 0;
+    totals.bytes = 0;
+    totals.tokens = 0;
+    for (int stage = 0; stage < STAGE_COUNT; ++stage) {
+        totals.stageCalls[stage] = 0;
+        totals.stageTicks[stage] = 0;
+    }
+}
+
+#else
+
+Snapshot snapshot(const DictionaryImage* dictionary) {
+    Snapshot result;
+    if (dictionary) {
+        result.imageNodes = dictionary->nodeCount();
+        result.imageEdges = dictionary->edgeCount();
+        result.imageBytes = dictionary->sizeBytes();
+    }
+    return result;
+}
+
+void reset() {}
+
+#endif
+
+void writeJson(ostream& out, const Snapshot& snapshot) {
+    const Counters& totals = snapshot.totals;
+    out << "{\"enabled\":" << (snapshot.enabled ? "true" : "false")
+        << ",\"documents\":" << totals.documents
+        << ",\"bytes\":" << totals.bytes
+        << ",\"tokens\":" << totals.tokens
+        << ",\"stages\":{";
+    for (int stage = 0; stage < STAGE_COUNT; ++stage) {
+        if (stage) out << ",";
+        uint64_t calls = totals.stageCalls[stage];
+        out << "\"" << stageName(static_cast<Stage>(stage)) << "\":{\"calls\":" << calls
+            << ",\"seconds\":" << snapshot.stageSeconds[stage]
+            << ",\"ns_per_call\":" << (calls ? snapshot.stageSeconds[stage] * 1e9 / calls : 0.0) << "}";
+    }
+    out << "},\"dictionary\":{\"nodes\":" << snapshot.imageNodes
+        << ",\"edges\":" << snapshot.imageEdges
+        << ",\"bytes\":" << snapshot.imageBytes
+        << "},\"languages\":[";
+    for (size_t i = 0; i < snapshot.languages.size(); ++i) {
+        const LanguageLoad& load = snapshot.languages[i];
+        if (i) out << ",";
+        out << "{\"name\":\"" << jsonEscape(load.name) << "\",\"words\":" << load.words
+            << ",\"trie_nodes\":" << load.trieNodes << ",\"trie_bytes\":" << load.trieBytes
+            << ",\"load_seconds\":" << load.loadSeconds << "}";
+    }
+    out << "]}";
+}
+
+} // namespace detection_stats
@@ -0,0 +1,122 @@
+#ifndef DETECTION_STATS_H
+#define DETECTION_STATS_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#if defined(LANGWITCH_ENABLE_STATS) && (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h>
+#endif
+
+class DictionaryImage;
+
+// Process-wide timing and size counters for detection, compiled in only when
+// the build defines LANGWITCH_ENABLE_STATS (CMake option LANGWITCH_STATS).
+// Otherwise the recording macros expand to nothing and snapshot() reports
+// `enabled` as false.
+//
+// Each detector times its stages into a local Counters block with the CPU
+// timestamp counter (steady_clock where there is none) and adds it to the
+// process totals once per document, so threads do not share cache lines
+// per token.
+namespace detection_stats {
+
+enum Stage {
+    TOKENIZE,    // splitting input into words
+    NORMALIZE,   // normalizeWordInto
+    LOOKUP,      // exact dictionary walk, or word cache probe
+    FUZZY,       // edit-distance fallback
+    NGRAM,       // n-gram scoring of unknown words
+    MATRIX,      // matrix and contributor updates
+    STAGE_COUNT
+};
+
+const char* stageName(Stage stage);
+
+struct Counters {
+    uint64_t documents = 0;
+    uint64_t bytes = 0;
+    uint64_t tokens = 0;
+    uint64_t stageCalls[STAGE_COUNT] = {};
+    uint64_t stageTicks[STAGE_COUNT] = {};
+};
+
+// Load statistics of one language's word list
+struct LanguageLoad {
+    std::string name;
+    size_t words = 0;
+    size_t trieNodes = 0;      // nodes this language added to the trie
+    size_t trieBytes = 0;      // heap bytes those nodes hold
+    double loadSeconds = 0.0;
+};
+
+struct Snapshot {
+    bool enabled = false;
+    Counters totals;
+    double stageSeconds[STAGE_COUNT] = {};
+    std::vector<LanguageLoad> languages;
+    size_t imageNodes = 0;
+    size_t imageEdges = 0;
+    size_t imageBytes = 0;
+};
+
+// Current totals, plus the size of `dictionary` if given
+Snapshot snapshot(const DictionaryImage* dictionary = nullptr);
+
+// Clears the detection totals; language load records are kept
+void reset();
+
+// One JSON object, stages and languages included
+void writeJson(std::ostream& out, const Snapshot& snapshot);
+
+#if defined(LANGWITCH_ENABLE_STATS)
+
+inline uint64_t ticks() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+}
+
+// Adds a detector's counters to the process totals
+void flush(const Counters& counters);
+
+void recordLanguageLoad(const LanguageLoad& load);
+
+class StageTimer {
+public:
+    StageTimer(Counters& counters, Stage stage) : counters(counters), stage(stage), start(ticks()) {}
+    ~StageTimer() {
+        counters.stageTicks[stage] += ticks() - start;
+        ++counters.stageCalls[stage];
+    }
+
+private:
+    Counters& counters;
+    Stage stage;
+    uint64_t start;
+};
+
+#define LANGWITCH_STATS_CONCAT2(a, b) a##b
+#define LANGWITCH_STATS_CONCAT(a, b) LANGWITCH_STATS_CONCAT2(a, b)
+// Times the rest of the enclosing scope as `stage`
+#define LANGWITCH_STATS_TIME(counters, stage) \
+    ::detection_stats::StageTimer LANGWITCH_STATS_CONCAT(statsTimer, __LINE__)((counters), ::detection_stats::stage)
+#define LANGWITCH_STATS_ADD(counters, field, amount) ((counters).field += (amount))
+
+#else
+
+#define LANGWITCH_STATS_TIME(counters, stage) ((void)0)
+#define LANGWITCH_STATS_ADD(counters, field, amount) ((void)0)
+
+#endif
+
+} // namespace detection_stats
+
+#endif
@@ -0,0 +1,64 @@
+#include "detection_worker.h"
+
+using namespace std;
+
+DetectionWorker::DetectionWorker(const DictionaryImage& dictionary, const DetectionOptions& options, Callback done)
+    : detector(dictionary, options), done(std::move(done)) {
+    workerThread = std::thread([this] { run(); });
+}
+
+DetectionWorker::~DetectionWorker() {
+    {
+        lock_guard<mutex> lock(requestMutex);
+        stopping = true;
+        pendingRequest = 0;
+        if (running) running->store(true, memory_order_relaxed);
+    }
+    wake.notify_one();
+    workerThread.join();
+}
+
+uint64_t DetectionWorker::submit(string text) {
+    uint64_t request;
+    {
+        lock_guard<mutex> lock(requestMutex);
+        request = ++lastRequest;
+        pendingText = std::move(text);
+        pendingRequest = request;
+        if (running) running->store(true, memory_order_relaxed);
+    }
+    wake.notify_one();
+    return request;
+}
+
+void DetectionWorker::cancel() {
+    lock_guard<mutex> lock(requestMutex);
+    pendingRequest = 0;
+    pendingText.clear();
+    if (running) running->store(true, memory_order_relaxed);
+}
+
+void DetectionWorker::run() {
+    for (;;) {
+        string text;
+        uint64_t request;
+        shared_ptr<atomic<bool>> cancelled = make_shared<atomic<bool>>(false);
+        {
+            unique_lock<mutex> lock(requestMutex);
+            running.reset();
+            wake.wait(lock, [this] { return stopping || pendingRequest != 0; });
+            if (stopping) return;
+            text.swap(pendingText);
+            request = pendingRequest;
+            pendingRequest = 0;
+            running = cancelled;
+        }
+
+        DetectionResult result;
+        if (!detector.update(text, &result, cancelled.get())) continue;
+
+        // A request submitted while this one was finishing supersedes it
+        if (cancelled->load(memory_order_relaxed)) continue;
+        done(request, text, result);
+    }
+}
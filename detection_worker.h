@@ -0,0 +1,60 @@
+#ifndef DETECTION_WORKER_H
+#define DETECTION_WORKER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "language_detector.h"
+
+// Detects text on one background thread so a UI never waits for it.
+//
+// Only the newest request matters: submitting one cancels the detection in
+// progress and drops any request still waiting. Texts go through an
+// IncrementalDetector, so resubmitting an edited document only reads the
+// lines that changed.
+class DetectionWorker {
+public:
+    // Called on the worker thread for every request that finished without
+    // being superseded. `text` is the submitted text, which the contributor
+    // spans of `result` point into.
+    using Callback = std::function<void(uint64_t request, const std::string& text, const DetectionResult& result)>;
+
+    DetectionWorker(const DictionaryImage& dictionary, const DetectionOptions& options, Callback done);
+
+    DetectionWorker(const DetectionWorker&) = delete;
+    DetectionWorker& operator=(const DetectionWorker&) = delete;
+
+    // Cancels any detection and joins the thread; no callback runs after
+    ~DetectionWorker();
+
+    // Queues `text` in place of any earlier request and returns its number.
+    // Numbers increase, so a caller can ignore results older than the last
+    // one it asked for.
+    uint64_t submit(std::string text);
+
+    // Abandons the pending and running request without starting another
+    void cancel();
+
+private:
+    void run();
+
+    IncrementalDetector detector;
+    Callback done;
+
+    std::mutex requestMutex;
+    std::condition_variable wake;
+    std::string pendingText;
+    uint64_t pendingRequest = 0;     // 0 when nothing is waiting
+    uint64_t lastRequest = 0;
+    std::shared_ptr<std::atomic<bool>> running;   // cancel flag of the detection in progress
+    bool stopping = false;
+
+    std::thread workerThread;
+};
+
+#endif
@@ -0,0 +1,508 @@
+#include "dictionary_image.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <unordered_map>
+#include <utility>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+using namespace dictionary_format;
+
+namespace {
+
+// Bottom-up hash-consing: two trie nodes are merged when they have the same
+// masks and the same labelled edges to already-merged children
+struct ImageCompiler {
+    explicit ImageCompiler(const MultiLanguageTrie& trie) : trie(trie) {}
+
+    const MultiLanguageTrie& trie;
+    vector<MaskPair> masks;
+    map<pair<LanguageMask, LanguageMask>, uint32_t> maskIds;
+    vector<ImageNode> nodes;
+    vector<uint32_t> edgeTargets;
+    vector<uint8_t> edgeLabels;
+    unordered_map<string, uint32_t> registry;
+
+    uint32_t maskId(LanguageMask exact, LanguageMask normalized) {
+        auto key = make_pair(exact, normalized);
+        auto it = maskIds.find(key);
+        if (it != maskIds.end()) return it->second;
+        uint32_t id = static_cast<uint32_t>(masks.size());
+        masks.push_back({exact, normalized});
+        maskIds.emplace(key, id);
+        return id;
+    }
+
+    uint32_t add(const TrieNode* node) {
+        uint32_t mask = maskId(node->exactMask, node->normalizedMask);
+
+        vector<uint32_t> childIds(node->childCount);
+        for (uint16_t i = 0; i < node->childCount; ++i) childIds[i] = add(trie.getChild(node, i));
+
+        string signature(reinterpret_cast<const char*>(&mask), sizeof(mask));
+        for (uint16_t i = 0; i < node->childCount; ++i) {
+            signature += static_cast<char>(node->keys()[i]);
+            signature.append(reinterpret_cast<const char*>(&childIds[i]), sizeof(uint32_t));
+        }
+
+        auto it = registry.find(signature);
+        if (it != registry.end()) return it->second;
+
+        uint32_t id = static_cast<uint32_t>(nodes.size());
+        nodes.push_back({static_cast<uint32_t>(edgeLabels.size()), mask});
+        for (uint16_t i = 0; i < node->childCount; ++i) {
+            edgeLabels.push_back(node->keys()[i]);
+            edgeTargets.push_back(childIds[i]);
+        }
+        registry.emplace(move(signature), id);
+        return id;
+    }
+};
+
+uint64_t alignTo8(uint64_t offset) {
+    return (offset + 7) & ~uint64_t(7);
+}
+
+template <typename T>
+void writeAt(vector<uint8_t>& image, uint64_t offset, const T* items, size_t count) {
+    if (count) memcpy(image.data() + offset, items, count * sizeof(T));
+}
+
+} // namespace
+
+vector<uint8_t> DictionaryImage::compile(const MultiLanguageTrie& trie) {
+    ImageCompiler compiler(trie);
+    uint32_t root = compiler.add(trie.getRoot());
+
+    // Sentinel so every node's edge range is [firstEdge, next.firstEdge)
+    uint32_t nodeCount = static_cast<uint32_t>(compiler.nodes.size());
+    compiler.nodes.push_back({static_cast<uint32_t>(compiler.edgeLabels.size()), 0});
+
+    string names;
+    vector<uint32_t> nameOffsets;
+    for (size_t i = 0; i < trie.languageCount(); ++i) {
+        nameOffsets.push_back(static_cast<uint32_t>(names.size()));
+        names += trie.getLanguageName(i);
+        names += '\0';
+    }
+
+    ImageHeader header = {};
+    memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.byteOrderMark = BYTE_ORDER_MARK;
+    header.languageCount = static_cast<uint32_t>(trie.languageCount());
+    header.maskCount = static_cast<uint32_t>(compiler.masks.size());
+    header.nodeCount = nodeCount;
+    header.edgeCount = static_cast<uint32_t>(compiler.edgeLabels.size());
+    header.rootNode = root;
+    header.namesSize = static_cast<uint32_t>(names.size());
+
+    uint64_t offset = alignTo8(sizeof(ImageHeader));
+    header.nameOffsetsOffset = offset;
+    offset = alignTo8(offset + nameOffsets.size() * sizeof(uint32_t));
+    header.namesOffset = offset;
+    offset = alignTo8(offset + names.size());
+    header.masksOffset = offset;
+    offset = alignTo8(offset + compiler.masks.size() * sizeof(MaskPair));
+    header.nodesOffset = offset;
+    offset = alignTo8(offset + compiler.nodes.size() * sizeof(ImageNode));
+    header.edgeTargetsOffset = offset;
+    offset = alignTo8(offset + compiler.edgeTargets.size() * sizeof(uint32_t));
+    header.edgeLabelsOffset = offset;
+    // Labels are padded so lookups can always read eight at a time
+    offset = alignTo8(offset + compiler.edgeLabels.size() + 8);
+    header.totalSize = offset;
+
+    vector<uint8_t> image(header.totalSize, 0);
+    writeAt(image, 0, &header, 1);
+    writeAt(image, header.nameOffsetsOffset, nameOffsets.data(), nameOffsets.size());
+    writeAt(image, header.namesOffset, names.data(), names.size());
+    writeAt(image, header.masksOffset, compiler.masks.data(), compiler.masks.size());
+    writeAt(image, header.nodesOffset, compiler.nodes.data(), compiler.nodes.size());
+    writeAt(image, header.edgeTargetsOffset, compiler.edgeTargets.data(), compiler.edgeTargets.size());
+    writeAt(image, header.edgeLabelsOffset, compiler.edgeLabels.data(), compiler.edgeLabels.size());
+    return image;
+}
+
+DictionaryImage::~DictionaryImage() {
+    release();
+}
+
+DictionaryImage::DictionaryImage(DictionaryImage&& other) noexcept {
+    *this = move(other);
+}
+
+DictionaryImage& DictionaryImage::operator=(DictionaryImage&& other) noexcept {
+    if (this == &other) return *this;
+    release();
+
+    owned = move(other.owned);
+    mapping = other.mapping;
+    mappingSize = other.mappingSize;
+    data = other.data;
+    size = other.size;
+    header = other.header;
+    nameOffsets = other.nameOffsets;
+    names = other.names;
+    masks = other.masks;
+    nodes = other.nodes;
+    edgeTargets = other.edgeTargets;
+    edgeLabels = other.edgeLabels;
+
+    other.mapping = nullptr;
+    other.mappingSize = 0;
+    other.data = nullptr;
+    other.size = 0;
+    other.header = nullptr;
+    return *this;
+}
+
+void DictionaryImage::release() {
+#ifndef _WIN32
+    if (mapping) munmap(mapping, mappingSize);
+#endif
+    mapping = nullptr;
+    mappingSize = 0;
+    owned.clear();
+    owned.shrink_to_fit();
+    data = nullptr;
+    size = 0;
+    header = nullptr;
+}
+
+bool DictionaryImage::openFile(const string& path) {
+    release();
+
+#ifndef _WIN32
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        cerr << "Error: Could not open file " << path << "\n";
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size <= 0) {
+        cerr << "Error: Could not read dictionary image " << path << "\n";
+        close(fd);
+        return false;
+    }
+
+    size_t length = static_cast<size_t>(info.st_size);
+    void* mapped = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) {
+        cerr << "Error: Could not map dictionary image " << path << "\n";
+        return false;
+    }
+
+    mapping = mapped;
+    mappingSize = length;
+    if (!bind(static_cast<const uint8_t*>(mapped), length, path.c_str())) {
+        release();
+        return false;
+    }
+    return true;
+#else
+    // No mmap here: read the image into memory instead
+    ifstream file(path, ios::binary);
+    if (!file.is_open()) {
+        cerr << "Error: Could not open file " << path << "\n";
+        return false;
+    }
+    vector<uint8_t> buffer((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+    return loadFromBuffer(move(buffer));
+#endif
+}
+
+bool DictionaryImage::loadFromBuffer(vector<uint8_t> buffer) {
+    release();
+    owned = move(buffer);
+    if (!bind(owned.data(), owned.size(), "buffer")) {
+        release();
+        return false;
+    }
+    return true;
+}
+
+bool DictionaryImage::attach(const void* bytes, size_t length) {
+    release();
+    if (!bind(static_cast<const uint8_t*>(bytes), length, "attached data")) {
+        release();
+        return false;
+    }
+    return true;
+}
+
+// Checks the header and every offset so lookups never leave the image
+bool DictionaryImage::bind(const uint8_t* bytes, size_t length, const char* origin) {
+    auto fail = [origin](const char* reason) {
+        cerr << "Error: Invalid dictionary image (" << origin << "): " << reason << "\n";
+        return false;
+    };
+
+    if (reinterpret_cast<uintptr_t>(bytes) % 8 != 0) return fail("misaligned data");
+    if (length < sizeof(ImageHeader)) return fail("truncated header");
+
+    const ImageHeader* h = reinterpret_cast<const ImageHeader*>(bytes);
+    if (memcmp(h->magic, MAGIC, sizeof(MAGIC)) != 0) return fail("bad magic");
+    if (h->byteOrderMark != BYTE_ORDER_MARK) return fail("wrong byte order");
+    if (h->version != VERSION) return fail("unsupported version");
+    if (h->totalSize > length) return fail("truncated image");
+    if (h->languageCount > MAX_LANGUAGES) return fail("too many languages");
+    if (h->nodeCount == 0 || h->rootNode >= h->nodeCount) return fail("bad root node");
+
+    auto sectionOk = [h](uint64_t offset, uint64_t bytesNeeded) {
+        return offset % 8 == 0 && offset <= h->totalSize && bytesNeeded <= h->totalSize - offset;
+    };
+    if (!sectionOk(h->nameOffsetsOffset, uint64_t(h->languageCount) * sizeof(uint32_t)) ||
+        !sectionOk(h->namesOffset, h->namesSize) ||
+        !sectionOk(h->masksOffset, uint64_t(h->maskCount) * sizeof(MaskPair)) ||
+        !sectionOk(h->nodesOffset, (uint64_t(h->nodeCount) + 1) * sizeof(ImageNode)) ||
+        !sectionOk(h->edgeTargetsOffset, uint64_t(h->edgeCount) * sizeof(uint32_t)) ||
+        !sectionOk(h->edgeLabelsOffset, uint64_t(h->edgeCount) + 8)) {
+        return fail("section out of bounds");
+    }
+
+    const uint32_t* offsets = reinterpret_cast<const uint32_t*>(bytes + h->nameOffsetsOffset);
+    const char* nameTable = reinterpret_cast<const char*>(bytes + h->namesOffset);
+    if (h->languageCount && (h->namesSize == 0 || nameTable[h->namesSize - 1] != '\0'))
+        return fail("bad name table");
+    for (uint32_t i = 0; i < h->languageCount; ++i) {
+        if (offsets[i] >= h->namesSize) return fail("bad name offset");
+    }
+
+    const ImageNode* nodeTable = reinterpret_cast<const ImageNode*>(bytes + h->nodesOffset);
+    const uint32_t* targets = reinterpret_cast<const uint32_t*>(bytes + h->edgeTargetsOffset);
+    for (uint32_t i = 0; i < h->nodeCount; ++i) {
+        if (nodeTable[i].maskIndex >= h->maskCount) return fail("bad mask index");
+        if (nodeTable[i].firstEdge > nodeTable[i + 1].firstEdge) return fail("bad edge range");
+    }
+    if (nodeTable[h->nodeCount].firstEdge != h->edgeCount) return fail("bad edge count");
+    for (uint32_t i = 0; i < h->edgeCount; ++i) {
+        if (targets[i] >= h->nodeCount) return fail("bad edge target");
+    }
+
+    data = bytes;
+    size = h->totalSize;
+    header = h;
+    nameOffsets = offsets;
+    names = nameTable;
+    masks = reinterpret_cast<const MaskPair*>(bytes + h->masksOffset);
+    nodes = nodeTable;
+    edgeTargets = targets;
+    edgeLabels = bytes + h->edgeLabelsOffset;
+    return true;
+}
+
+string_view DictionaryImage::getLanguageName(size_t language) const {
+    return string_view(names + nameOffsets[language]);
+}
+
+LanguageMatch DictionaryImage::lookup(string_view key) const {
+    LanguageMatch match;
+    if (!header) return match;
+
+    uint32_t node = header->rootNode;
+    for (char ch : key) {
+        uint8_t label = static_cast<uint8_t>(ch);
+        uint32_t first = nodes[node].firstEdge;
+        uint32_t last = nodes[node + 1].firstEdge;
+
+        // Same eight-at-a-time key scan as TrieNode::findChild
+        uint32_t found = last;
+        for (uint32_t base = first; base < last; base += 8) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+            uint64_t chunk;
+            memcpy(&chunk, edgeLabels + base, sizeof(chunk));
+            uint64_t x = chunk ^ (0x0101010101010101ULL * label);
+            uint64_t hit = (x - 0x0101010101010101ULL) & ~x & 0x8080808080808080ULL;
+            if (hit) {
+                found = base + (__builtin_ctzll(hit) >> 3);
+                break;
+            }
+#else
+            for (uint32_t i = base; i < base + 8 && i < last; ++i) {
+                if (edgeLabels[i] == label) { found = i; break; }
+            }
+            if (found != last) break;
+#endif
+        }
+        if (found >= last) return match;
+        node = edgeTargets[found];
+    }
+
+    const MaskPair& masksHere = masks[nodes[node].maskIndex];
+    match.exact = masksHere.exact;
+    match.normalized = masksHere.normalized;
+    return match;
+}
+
+void DictionaryImage::forEachWord(const function<void(string_view, LanguageMatch)>& visit) const {
+    if (!header) return;
+
+    // Explicit stack of (node, next edge); `word` holds the path to the top
+    vector<pair<uint32_t, uint32_t>> stack;
+    string word;
+    stack.push_back({header->rootNode, nodes[header->rootNode].firstEdge});
+    while (!stack.empty()) {
+        auto& top = stack.back();
+        if (top.second == nodes[top.first].firstEdge) {
+            const MaskPair& here = masks[nodes[top.first].maskIndex];
+            if (here.exact | here.normalized) {
+                LanguageMatch match;
+                match.exact = here.exact;
+                match.normalized = here.normalized;
+                visit(word, match);
+            }
+        }
+        if (top.second == nodes[top.first + 1].firstEdge) {
+            stack.pop_back();
+            if (!word.empty()) word.pop_back();
+            continue;
+        }
+        uint32_t edge = top.second++;
+        word.push_back(static_cast<char>(edgeLabels[edge]));
+        uint32_t child = edgeTargets[edge];
+        stack.push_back({child, nodes[child].firstEdge});
+    }
+}
+
+namespace {
+
+// Levenshtein automaton for up to MAX_EDIT_DISTANCE edits.
+//
+// Walking the automaton along a path keeps one row of the edit-distance table
+// per depth: row[j] is the distance between the path so far and the first j
+// bytes of the key. Only the diagonal band j = depth - limit ... depth + limit
+// can still be within the limit, and values above the limit can be clamped
+// to limit + 1 without changing which entries stay within it. A state is
+// therefore the band, 2 * limit + 1 entries of 2 bits each, and a transition
+// depends only on the state and on which band positions of the key equal the
+// next byte. Every transition is precomputed, so a step is a table lookup.
+struct LevenshteinTable {
+    unsigned limit;
+    unsigned width;               // band entries
+    std::vector<uint16_t> next;   // [state << width | matches] -> next state | (min << 10)
+
+    explicit LevenshteinTable(unsigned limit) : limit(limit), width(2 * limit + 1) {
+        const unsigned far = limit + 1;
+        next.resize(size_t(1) << (3 * width));
+        for (uint32_t state = 0; state < (1u << (2 * width)); ++state) {
+            for (uint32_t matches = 0; matches < (1u << width); ++matches) {
+                uint32_t packed = 0;
+                unsigned rowMin = far;
+                unsigned left = far;
+                for (unsigned r = 0; r < width; ++r) {
+                    unsigned diagonal = cell(state, r) + !((matches >> r) & 1);
+                    unsigned up = r + 1 < width ? cell(state, r + 1) + 1 : far;
+                    unsigned value = std::min({diagonal, up, left + 1, far});
+                    packed |= value << (2 * r);
+                    left = value;
+                    rowMin = std::min(rowMin, value);
+                }
+                next[(state << width) | matches] = static_cast<uint16_t>(packed | (rowMin << 10));
+            }
+        }
+    }
+
+    unsigned cell(uint32_t state, unsigned r) const {
+        return std::min((state >> (2 * r)) & 3u, limit + 1);
+    }
+
+    // State at depth 0: entry j of the band is j - limit, absent below 0
+    uint32_t start(size_t keyLength) const {
+        uint32_t state = 0;
+        for (unsigned r = 0; r < width; ++r) {
+            size_t value = limit + 1;
+            if (r >= limit && r - limit <= keyLength) value = r - limit;
+            state |= static_cast<uint32_t>(value) << (2 * r);
+        }
+        return state;
+    }
+};
+
+const LevenshteinTable& levenshteinTable(unsigned limit) {
+    static const LevenshteinTable tables[] = {LevenshteinTable(1), LevenshteinTable(2)};
+    return tables[limit - 1];
+}
+
+// Depth-first walk of the dictionary in step with the automaton; a branch is
+// dropped as soon as no band entry is within the limit. Only lowercase ASCII
+// edges are followed, since that is all a normalized key can match, and the
+// first byte must match exactly: typos rarely hit the first letter and this
+// keeps the walk away from the widest part of the dictionary.
+struct FuzzyWalk {
+    const LevenshteinTable* table;
+    const ImageNode* nodes;
+    const uint32_t* edgeTargets;
+    const uint8_t* edgeLabels;
+    const MaskPair* masks;
+    uint8_t first;
+    size_t keyLength;
+    uint64_t keyMask[26];   // bit k + limit set where key[k] is the letter
+    LanguageMask found = 0;
+
+    void visit(uint32_t node, size_t depth, uint32_t state) {
+        unsigned limit = table->limit;
+        size_t r = keyLength + limit - depth;
+        // Distance 0 is the key itself, which lookup() reports; leaving it
+        // out keeps the reported distance exact
+        unsigned cost = r < table->width ? (state >> (2 * r)) & 3u : limit + 1;
+        if (cost != 0 && cost <= limit) {
+            const MaskPair& here = masks[nodes[node].maskIndex];
+            found |= here.exact | here.normalized;
+        }
+
+        uint32_t band = (1u << table->width) - 1;
+        for (uint32_t edge = nodes[node].firstEdge; edge < nodes[node + 1].firstEdge; ++edge) {
+            uint8_t label = edgeLabels[edge];
+            unsigned letter = static_cast<uint8_t>(label - 'a');
+            if (letter >= 26 || (depth == 0 && label != first)) continue;
+            uint32_t matches = static_cast<uint32_t>(keyMask[letter] >> depth) & band;
+            uint16_t step = table->next[(state << table->width) | matches];
+            if ((step >> 10) <= limit) visit(edgeTargets[edge], depth + 1, step & 0x3FF);
+        }
+    }
+};
+
+} // namespace
+
+LanguageMask DictionaryImage::fuzzyLookup(string_view key, unsigned maxDistance, unsigned* distance) const {
+    if (distance) *distance = 0;
+    if (!header || key.empty() || key.size() > MAX_FUZZY_KEY) return 0;
+    if (maxDistance > MAX_EDIT_DISTANCE) maxDistance = MAX_EDIT_DISTANCE;
+
+    FuzzyWalk walk;
+    walk.nodes = nodes;
+    walk.edgeTargets = edgeTargets;
+    walk.edgeLabels = edgeLabels;
+    walk.masks = masks;
+    walk.first = static_cast<uint8_t>(key[0]);
+    walk.keyLength = key.size();
+
+    // Widen one edit at a time: a search at a small limit is much cheaper,
+    // and only the closest words are reported
+    for (unsigned limit = 1; limit <= maxDistance; ++limit) {
+        walk.table = &levenshteinTable(limit);
+        for (uint64_t& mask : walk.keyMask) mask = 0;
+        for (size_t k = 0; k < key.size(); ++k) {
+            unsigned letter = static_cast<uint8_t>(key[k] - 'a');
+            if (letter < 26) walk.keyMask[letter] |= uint64_t(1) << (k + limit);
+        }
+        walk.visit(header->rootNode, 0, walk.table->start(key.size()));
+        if (walk.found) {
+            if (distance) *distance = limit;
+            return walk.found;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,140 @@
+#ifndef DICTIONARY_IMAGE_H
+#define DICTIONARY_IMAGE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "multi_language_trie.h"
+
+// Read-only, pointer-free form of a MultiLanguageTrie.
+//
+// The trie is minimized into an acyclic automaton (words sharing a suffix
+// share the nodes for it) and laid out as flat arrays addressed by 32-bit
+// offsets, so the same bytes can be written to disk, memory-mapped by any
+// number of processes and queried in place. Layout, all little-endian and
+// 8-byte aligned:
+//
+//     ImageHeader
+//     uint32_t nameOffsets[languageCount]   offsets into the name table
+//     char     names[]                      NUL-terminated language names
+//     MaskPair masks[maskCount]             distinct (exact, normalized) pairs
+//     ImageNode nodes[nodeCount + 1]        last entry is a sentinel
+//     uint32_t edgeTargets[edgeCount]       target node of each edge
+//     uint8_t  edgeLabels[edgeCount + 8]    edge bytes, sorted per node
+//
+// The edges of node i are [nodes[i].firstEdge, nodes[i + 1].firstEdge).
+namespace dictionary_format {
+
+const char MAGIC[8] = {'L', 'W', 'D', 'I', 'C', 'T', '\0', '\0'};
+// Bumped whenever normalization changes, since images store normalized keys
+const uint32_t VERSION = 2;
+const uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+struct ImageHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrderMark;
+    uint32_t languageCount;
+    uint32_t maskCount;
+    uint32_t nodeCount;
+    uint32_t edgeCount;
+    uint32_t rootNode;
+    uint32_t namesSize;
+    uint64_t nameOffsetsOffset;
+    uint64_t namesOffset;
+    uint64_t masksOffset;
+    uint64_t nodesOffset;
+    uint64_t edgeTargetsOffset;
+    uint64_t edgeLabelsOffset;
+    uint64_t totalSize;
+};
+
+struct MaskPair {
+    LanguageMask exact;
+    LanguageMask normalized;
+};
+
+struct ImageNode {
+    uint32_t firstEdge;
+    uint32_t maskIndex;
+};
+
+} // namespace dictionary_format
+
+class DictionaryImage {
+public:
+    DictionaryImage() = default;
+    ~DictionaryImage();
+
+    DictionaryImage(const DictionaryImage&) = delete;
+    DictionaryImage& operator=(const DictionaryImage&) = delete;
+    DictionaryImage(DictionaryImage&& other) noexcept;
+    DictionaryImage& operator=(DictionaryImage&& other) noexcept;
+
+    // Minimizes the trie and returns the serialized image
+    static std::vector<uint8_t> compile(const MultiLanguageTrie& trie);
+
+    // Memory-maps a compiled image read-only. Returns false (and reports the
+    // reason on stderr) if the file is missing or not a valid image.
+    bool openFile(const std::string& path);
+
+    // Takes ownership of an image held in memory, e.g. fresh from compile()
+    bool loadFromBuffer(std::vector<uint8_t> buffer);
+
+    // Uses an image that lives elsewhere (static data, shared memory) without
+    // copying it. The bytes must outlive this object and be 8-byte aligned.
+    bool attach(const void* data, size_t size);
+
+    bool isLoaded() const { return header != nullptr; }
+
+    size_t languageCount() const { return header ? header->languageCount : 0; }
+    std::string_view getLanguageName(size_t language) const;
+
+    // Walks the automaton once and reports every language matching the key.
+    // As with MultiLanguageTrie::lookup, callers should normalize free text.
+    LanguageMatch lookup(std::string_view key) const;
+
+    // Languages containing a word within `maxDistance` edits (Levenshtein:
+    // insert, delete or substitute one byte, at most MAX_EDIT_DISTANCE) of a
+    // normalized key whose first letter is right. Only the closest words
+    // count, so a word one edit away hides those two edits away; their
+    // distance (1 or 2) is stored in `distance`. The key itself is not
+    // reported, even when it is a word: use lookup() for that. Returns 0 when
+    // nothing is close enough or the key is longer than MAX_FUZZY_KEY.
+    LanguageMask fuzzyLookup(std::string_view key, unsigned maxDistance, unsigned* distance = nullptr) const;
+
+    // Calls `visit` once per stored word, in byte order, with the languages
+    // it belongs to. Words sharing a suffix are spelled out separately, so
+    // this costs time proportional to the total length of all words.
+    void forEachWord(const std::function<void(std::string_view word, LanguageMatch match)>& visit) const;
+
+    static const unsigned MAX_EDIT_DISTANCE = 2;
+    static const size_t MAX_FUZZY_KEY = 32;
+
+    size_t nodeCount() const { return header ? header->nodeCount : 0; }
+    size_t edgeCount() const { return header ? header->edgeCount : 0; }
+    size_t sizeBytes() const { return size; }
+
+private:
+    bool bind(const uint8_t* bytes, size_t length, const char* origin);
+    void release();
+
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+    std::vector<uint8_t> owned;
+    void* mapping = nullptr;
+    size_t mappingSize = 0;
+
+    const dictionary_format::ImageHeader* header = nullptr;
+    const uint32_t* nameOffsets = nullptr;
+    const char* names = nullptr;
+    const dictionary_format::MaskPair* masks = nullptr;
+    const dictionary_format::ImageNode* nodes = nullptr;
+    const uint32_t* edgeTargets = nullptr;
+    const uint8_t* edgeLabels = nullptr;
+};
+
+#endif
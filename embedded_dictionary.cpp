@@ -0,0 +1,15 @@
+#include "embedded_dictionary.h"
+#include <iostream>
+
+using namespace std;
+
+bool loadDefaultDictionary(DictionaryImage* image, const string& executablePath, string* directory,
+                           ThreadPool* pool, const LoadProgress& progress) {
+    if (findDataOverride(executablePath, directory)) {
+        if (buildDictionary(image, *directory, pool, progress)) return true;
+        cerr << "Error: Could not load dictionaries from " << *directory << "\n";
+        return false;
+    }
+    directory->clear();
+    return attachEmbeddedDictionary(image);
+}
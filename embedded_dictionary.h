@@ -0,0 +1,29 @@
+#ifndef EMBEDDED_DICTIONARY_H
+#define EMBEDDED_DICTIONARY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "language_detector.h"
+
+// The dictionary image of the word lists the program was built with. The
+// build compiles them with langwitch-compile --cpp into a generated source
+// (part of the langwitch-embedded library), so the image is constant data in
+// the executable: attaching it reads no file and allocates nothing, and its
+// pages are shared by every process running the program.
+extern const uint64_t LANGWITCH_EMBEDDED_DICTIONARY[];
+extern const size_t LANGWITCH_EMBEDDED_DICTIONARY_SIZE;
+
+inline bool attachEmbeddedDictionary(DictionaryImage* image) {
+    return image->attach(LANGWITCH_EMBEDDED_DICTIONARY, LANGWITCH_EMBEDDED_DICTIONARY_SIZE);
+}
+
+// Loads the dictionary a program uses when it is not given one: the word
+// lists of the data override (see findDataOverride) for custom deployments,
+// else the embedded image. `directory` receives the override's directory,
+// or is cleared when the embedded image was used. `pool` and `progress` are
+// passed to buildDictionary for the word lists.
+bool loadDefaultDictionary(DictionaryImage* image, const std::string& executablePath, std::string* directory,
+                           ThreadPool* pool = nullptr, const LoadProgress& progress = nullptr);
+
+#endif
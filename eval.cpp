@@ -0,0 +1,455 @@
+#include "embedded_dictionary.h"
+#include "json_util.h"
+#include "language_detector.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Accuracy and throughput regression runner: detects labeled corpora in
+// parallel, reports accuracy per language, the confusion matrix and timing,
+// and compares them with a stored baseline.
+
+struct Document {
+    string label;
+    string text;
+    string source;   // file:line, for listing misses
+};
+
+struct EvalOptions {
+    string dictDir;
+    string imagePath;
+    bool useNgrams = true;
+    DetectionOptions detection;
+    size_t threads = 0;
+    size_t passes = 3;
+    size_t cacheSlots = 0;
+    string baselinePath;
+    string writeBaselinePath;
+    double accuracyTolerance = 0.005;     // absolute
+    double throughputTolerance = 0.10;    // fraction of the baseline rate
+    size_t showMisses = 0;
+    vector<string> corpora;
+};
+
+static void printUsage(const char* program) {
+    cerr << "Usage: " << program << " [options] corpus...\n"
+         << "\n"
+         << "Detects every document of the labeled corpora and reports accuracy per\n"
+         << "language, the confusion matrix, docs/s and latency percentiles: a table on\n"
+         << "stderr and JSON on stdout. Exits with 1 if a baseline is given and accuracy\n"
+         << "or throughput fell below it.\n"
+         << "\n"
+         << "A corpus is a text file with one document per line, written as the\n"
+         << "expected language (or Unknown), a tab, and the text. \\n, \\t and \\\\ in the\n"
+         << "text stand for a line break, a tab and a backslash. Empty lines and lines\n"
+         << "starting with # are skipped.\n"
+         << "\n"
+         << "Options:\n"
+         << "  --dict-dir DIR   directory holding languages.manifest or *.txt word lists\n"
+         << "                   (default: $LANGWITCH_DATA_DIR or a manifest next to the\n"
+         << "                   program, else the dictionary built into the program)\n"
+         << "  --dictionary F   use an image built by langwitch-compile instead\n"
+         << "  --threads N      worker threads (default: all cores)\n"
+         << "  --passes N       timed passes over the corpora; the fastest counts\n"
+         << "                   (default: 3)\n"
+         << "  --max-edits N    typos tolerated in unknown words, 0-2 (default: 2)\n"
+         << "  --no-ngrams      do not guess unknown words from their letter n-grams\n"
+         << "  --cache N        cache the matches of N recent distinct words\n"
+         << "  --baseline F     compare with a baseline written by --write-baseline\n"
+         << "  --write-baseline F\n"
+         << "                   store this run's accuracy and throughput as a baseline\n"
+         << "  --accuracy-tolerance X\n"
+         << "                   accuracy points a run may lose, as a fraction\n"
+         << "                   (default: 0.005)\n"
+         << "  --throughput-tolerance X\n"
+         << "                   share of the baseline docs/s a run may lose (default: 0.1)\n"
+         << "  --show-misses N  list up to N misdetected documents on stderr\n"
+         << "  -h, --help       show this help\n";
+}
+
+// Undoes the \n, \t and \\ escapes of a corpus line
+static string unescapeText(const string& text) {
+    string plain;
+    plain.reserve(text.size());
+    for (size_t i = 0; i < text.size(); ++i) {
+        if (text[i] != '\\' || i + 1 == text.size()) {
+            plain += text[i];
+            continue;
+        }
+        char next = text[++i];
+        if (next == 'n') plain += '\n';
+        else if (next == 't') plain += '\t';
+        else if (next == '\\') plain += '\\';
+        else {
+            plain += '\\';
+            plain += next;
+        }
+    }
+    return plain;
+}
+
+static bool loadCorpus(const string& path, vector<Document>* documents) {
+    ifstream file(path, ios::binary);
+    if (!file.is_open()) {
+        cerr << "Error: Could not open file " << path << "\n";
+        return false;
+    }
+
+    string line;
+    size_t lineNumber = 0;
+    bool ok = true;
+    while (getline(file, line)) {
+        ++lineNumber;
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (line.empty() || line[0] == '#') continue;
+
+        size_t tab = line.find('\t');
+        if (tab == string::npos || tab == 0) {
+            cerr << "Error: " << path << ":" << lineNumber << ": expected a language, a tab and the text\n";
+            ok = false;
+            continue;
+        }
+        Document document;
+        document.label = line.substr(0, tab);
+        document.text = unescapeText(line.substr(tab + 1));
+        document.source = path + ":" + to_string(lineNumber);
+        documents->push_back(move(document));
+    }
+    return ok;
+}
+
+struct Outcome {
+    string predicted;
+    double microseconds = 0.0;
+};
+
+// Detects every document on the pool, in blocks so short documents do not
+// drown in scheduling, and returns the wall-clock seconds
+static double runPass(const vector<Document>& documents, const DictionaryImage& dictionary,
+                      const DetectionOptions& options, ThreadPool& pool, vector<Outcome>* outcomes) {
+    const size_t BLOCK = 64;
+    outcomes->assign(documents.size(), Outcome());
+    auto start = chrono::steady_clock::now();
+    for (size_t first = 0; first < documents.size(); first += BLOCK) {
+        size_t last = min(first + BLOCK, documents.size());
+        pool.submit([&, first, last] {
+            for (size_t i = first; i < last; ++i) {
+                auto begin = chrono::steady_clock::now();
+                DetectionResult result = detectLanguageWithMatrix(documents[i].text, dictionary, options);
+                auto end = chrono::steady_clock::now();
+                (*outcomes)[i].predicted = move(result.language);
+                (*outcomes)[i].microseconds = chrono::duration<double, micro>(end - begin).count();
+            }
+        });
+    }
+    pool.wait();
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+static double percentile(const vector<double>& sorted, double p) {
+    if (sorted.empty()) return 0.0;
+    return sorted[static_cast<size_t>(p * (sorted.size() - 1) + 0.5)];
+}
+
+struct LanguageScore {
+    size_t documents = 0;
+    size_t correct = 0;
+    size_t predicted = 0;   // documents detected as this language
+
+    double accuracy() const { return documents ? double(correct) / documents : 0.0; }
+    double precision() const { return predicted ? double(correct) / predicted : 0.0; }
+};
+
+struct Report {
+    size_t documents = 0;
+    size_t correct = 0;
+    size_t bytes = 0;
+    double bestSeconds = 0.0;
+    vector<double> latencies;                  // microseconds, sorted
+    vector<string> labels;                     // rows and columns of the confusion matrix
+    map<string, LanguageScore> languages;
+    map<pair<string, string>, size_t> confusion;   // (expected, predicted) -> documents
+
+    double accuracy() const { return documents ? double(correct) / documents : 0.0; }
+    double documentsPerSecond() const { return bestSeconds > 0 ? documents / bestSeconds : 0.0; }
+    double megabytesPerSecond() const { return bestSeconds > 0 ? bytes / bestSeconds / 1e6 : 0.0; }
+};
+
+static void printReport(const Report& report) {
+    cerr << left << setw(12) << "language" << right << setw(10) << "docs" << setw(12) << "accuracy"
+         << setw(12) << "precision" << "\n";
+    for (const auto& entry : report.languages) {
+        const LanguageScore& score = entry.second;
+        if (!score.documents && !score.predicted) continue;
+        cerr << left << setw(12) << entry.first << right << setw(10) << score.documents << fixed
+             << setprecision(2) << setw(11) << score.accuracy() * 100 << "%" << setw(11)
+             << score.precision() * 100 << "%\n";
+    }
+    cerr << left << setw(12) << "all" << right << setw(10) << report.documents << setw(11)
+         << report.accuracy() * 100 << "%\n\n";
+
+    cerr << "confusion (rows: expected, columns: detected)\n" << setw(12) << "";
+    for (const string& label : report.labels) cerr << right << setw(10) << label.substr(0, 9);
+    cerr << "\n";
+    for (const string& expected : report.labels) {
+        cerr << left << setw(12) << expected << right;
+        for (const string& predicted : report.labels) {
+            auto found = report.confusion.find(make_pair(expected, predicted));
+            cerr << setw(10) << (found == report.confusion.end() ? 0 : found->second);
+        }
+        cerr << "\n";
+    }
+
+    cerr << "\n" << setprecision(1) << report.documentsPerSecond() << " docs/s, " << setprecision(2)
+         << report.megabytesPerSecond() << " MB/s; latency p50 " << setprecision(1)
+         << percentile(report.latencies, 0.50) << " us, p90 " << percentile(report.latencies, 0.90)
+         << " us, p99 " << percentile(report.latencies, 0.99) << " us, max "
+         << (report.latencies.empty() ? 0.0 : report.latencies.back()) << " us\n";
+}
+
+static void writeReportJson(ostream& out, const Report& report, size_t threads, size_t passes) {
+    out << "{\"documents\":" << report.documents << ",\"correct\":" << report.correct
+        << ",\"accuracy\":" << report.accuracy() << ",\"threads\":" << threads << ",\"passes\":" << passes
+        << ",\"docsPerSecond\":" << report.documentsPerSecond()
+        << ",\"megabytesPerSecond\":" << report.megabytesPerSecond()
+        << ",\"latencyUs\":{\"p50\":" << percentile(report.latencies, 0.50)
+        << ",\"p90\":" << percentile(report.latencies, 0.90) << ",\"p99\":" << percentile(report.latencies, 0.99)
+        << ",\"max\":" << (report.latencies.empty() ? 0.0 : report.latencies.back()) << "},\"languages\":{";
+    bool first = true;
+    for (const auto& entry : report.languages) {
+        if (!entry.second.documents && !entry.second.predicted) continue;
+        if (!first) out << ",";
+        first = false;
+        out << "\"" << jsonEscape(entry.first) << "\":{\"documents\":" << entry.second.documents
+            << ",\"accuracy\":" << entry.second.accuracy() << ",\"precision\":" << entry.second.precision() << "}";
+    }
+    out << "},\"labels\":[";
+    for (size_t i = 0; i < report.labels.size(); ++i) {
+        out << (i ? "," : "") << "\"" << jsonEscape(report.labels[i]) << "\"";
+    }
+    out << "],\"confusion\":[";
+    for (size_t row = 0; row < report.labels.size(); ++row) {
+        out << (row ? ",[" : "[");
+        for (size_t col = 0; col < report.labels.size(); ++col) {
+            auto found = report.confusion.find(make_pair(report.labels[row], report.labels[col]));
+            out << (col ? "," : "") << (found == report.confusion.end() ? 0 : found->second);
+        }
+        out << "]";
+    }
+    out << "]}";
+}
+
+// A baseline is "key value" lines: accuracy, docs_per_second and
+// accuracy.<language> for every language with documents
+static bool writeBaseline(const string& path, const Report& report) {
+    ofstream file(path);
+    if (!file.is_open()) {
+        cerr << "Error: Could not write baseline " << path << "\n";
+        return false;
+    }
+    file << "# langwitch-eval baseline\n" << setprecision(6) << fixed;
+    file << "accuracy " << report.accuracy() << "\n";
+    file << "docs_per_second " << report.documentsPerSecond() << "\n";
+    for (const auto& entry : report.languages) {
+        if (entry.second.documents) file << "accuracy." << entry.first << " " << entry.second.accuracy() << "\n";
+    }
+    return true;
+}
+
+static bool readBaseline(const string& path, map<string, double>* values) {
+    ifstream file(path);
+    if (!file.is_open()) {
+        cerr << "Error: Could not open baseline " << path << "\n";
+        return false;
+    }
+    string line;
+    while (getline(file, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        istringstream fields(line);
+        string key;
+        double value;
+        if (fields >> key >> value) (*values)[key] = value;
+    }
+    return true;
+}
+
+// Lists every way the report falls short of the baseline on stderr and
+// returns how many there were
+static size_t compareWithBaseline(const Report& report, const map<string, double>& baseline,
+                                  const EvalOptions& options) {
+    size_t regressions = 0;
+    auto check = [&](const string& what, double now, double before, double floor) {
+        if (now >= floor) return;
+        cerr << "Regression: " << what << " " << now << " < baseline " << before << " (floor " << floor << ")\n";
+        ++regressions;
+    };
+
+    cerr << setprecision(4) << defaultfloat;
+    for (const auto& entry : baseline) {
+        const string& key = entry.first;
+        double before = entry.second;
+        if (key == "accuracy") {
+            check("accuracy", report.accuracy(), before, before - options.accuracyTolerance);
+        } else if (key == "docs_per_second") {
+            check("docs/s", report.documentsPerSecond(), before, before * (1.0 - options.throughputTolerance));
+        } else if (key.compare(0, 9, "accuracy.") == 0) {
+            auto found = report.languages.find(key.substr(9));
+            if (found == report.languages.end() || !found->second.documents) {
+                cerr << "Warning: the corpora have no " << key.substr(9) << " documents, baseline entry ignored\n";
+                continue;
+            }
+            check(key.substr(9) + " accuracy", found->second.accuracy(), before,
+                  before - options.accuracyTolerance);
+        }
+    }
+    return regressions;
+}
+
+int main(int argc, char** argv) {
+    EvalOptions options;
+    options.detection.recordContributors = false;
+
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "-h" || arg == "--help") {
+            printUsage(argv[0]);
+            return 0;
+        } else if (arg == "--dict-dir" && i + 1 < argc) {
+            options.dictDir = argv[++i];
+        } else if (arg == "--dictionary" && i + 1 < argc) {
+            options.imagePath = argv[++i];
+        } else if (arg == "--threads" && i + 1 < argc) {
+            options.threads = static_cast<size_t>(strtoul(argv[++i], nullptr, 10));
+        } else if (arg == "--passes" && i + 1 < argc) {
+            options.passes = max<size_t>(1, strtoul(argv[++i], nullptr, 10));
+        } else if (arg == "--max-edits" && i + 1 < argc) {
+            options.detection.maxEditDistance = static_cast<unsigned>(strtoul(argv[++i], nullptr, 10));
+        } else if (arg == "--no-ngrams") {
+            options.useNgrams = false;
+        } else if (arg == "--cache" && i + 1 < argc) {
+            options.cacheSlots = static_cast<size_t>(strtoul(argv[++i], nullptr, 10));
+        } else if (arg == "--baseline" && i + 1 < argc) {
+            options.baselinePath = argv[++i];
+        } else if (arg == "--write-baseline" && i + 1 < argc) {
+            options.writeBaselinePath = argv[++i];
+        } else if (arg == "--accuracy-tolerance" && i + 1 < argc) {
+            options.accuracyTolerance = strtod(argv[++i], nullptr);
+        } else if (arg == "--throughput-tolerance" && i + 1 < argc) {
+            options.throughputTolerance = strtod(argv[++i], nullptr);
+        } else if (arg == "--show-misses" && i + 1 < argc) {
+            options.showMisses = static_cast<size_t>(strtoul(argv[++i], nullptr, 10));
+        } else if (arg.size() > 1 && arg[0] == '-') {
+            cerr << "Error: Unknown option " << arg << "\n";
+            printUsage(argv[0]);
+            return 2;
+        } else {
+            options.corpora.push_back(arg);
+        }
+    }
+    if (options.corpora.empty()) {
+        cerr << "Error: No corpus given\n";
+        printUsage(argv[0]);
+        return 2;
+    }
+
+    vector<Document> documents;
+    for (const string& path : options.corpora) {
+        if (!loadCorpus(path, &documents)) return 1;
+    }
+    if (documents.empty()) {
+        cerr << "Error: The corpora hold no documents\n";
+        return 1;
+    }
+
+    map<string, double> baseline;
+    if (!options.baselinePath.empty() && !readBaseline(options.baselinePath, &baseline)) return 1;
+
+    DictionaryImage dictionary;
+    string overrideDir;
+    if (!options.imagePath.empty()) {
+        if (!dictionary.openFile(options.imagePath)) return 1;
+    } else if (options.dictDir.empty()) {
+        if (!loadDefaultDictionary(&dictionary, argv[0], &overrideDir)) return 1;
+    } else if (!buildDictionary(&dictionary, options.dictDir)) {
+        cerr << "Error: Could not load dictionaries from " << options.dictDir << "\n";
+        return 1;
+    }
+
+    NgramProfile ngrams;
+    if (options.useNgrams && ngrams.build(dictionary)) options.detection.ngrams = &ngrams;
+    unique_ptr<WordCache> cache;
+    if (options.cacheSlots) {
+        cache.reset(new WordCache(options.cacheSlots));
+        options.detection.cache = cache.get();
+    }
+
+    ThreadPool pool(options.threads);
+    Report report;
+    report.documents = documents.size();
+    for (const Document& document : documents) report.bytes += document.text.size();
+
+    // Detection is deterministic, so accuracy comes from the first pass and
+    // every pass adds latency samples
+    vector<Outcome> first, outcomes;
+    for (size_t pass = 0; pass < options.passes; ++pass) {
+        double seconds = runPass(documents, dictionary, options.detection, pool, pass ? &outcomes : &first);
+        if (pass == 0 || seconds < report.bestSeconds) report.bestSeconds = seconds;
+        for (const Outcome& outcome : pass ? outcomes : first) report.latencies.push_back(outcome.microseconds);
+    }
+    sort(report.latencies.begin(), report.latencies.end());
+
+    // Dictionary languages first, then Unknown, then any other label
+    for (size_t i = 0; i < dictionary.languageCount(); ++i) {
+        report.labels.push_back(string(dictionary.getLanguageName(i)));
+    }
+    report.labels.push_back("Unknown");
+    size_t shownMisses = 0;
+    for (size_t i = 0; i < documents.size(); ++i) {
+        const string& expected = documents[i].label;
+        const string& predicted = first[i].predicted;
+        if (find(report.labels.begin(), report.labels.end(), expected) == report.labels.end()) {
+            report.labels.push_back(expected);
+        }
+        ++report.confusion[make_pair(expected, predicted)];
+        ++report.languages[expected].documents;
+        ++report.languages[predicted].predicted;
+        if (expected == predicted) {
+            ++report.correct;
+            ++report.languages[expected].correct;
+        } else if (shownMisses < options.showMisses) {
+            ++shownMisses;
+            cerr << "Miss: " << documents[i].source << ": expected " << expected << ", detected " << predicted
+                 << "\n";
+        }
+    }
+    if (shownMisses) cerr << "\n";
+
+    printReport(report);
+    writeReportJson(cout, report, pool.threadCount(), options.passes);
+    cout << "\n";
+
+    int status = 0;
+    if (!options.baselinePath.empty()) {
+        size_t regressions = compareWithBaseline(report, baseline, options);
+        if (regressions) {
+            cerr << regressions << " regression(s) against " << options.baselinePath << "\n";
+            status = 1;
+        } else {
+            cerr << "No regressions against " << options.baselinePath << "\n";
+        }
+    }
+    if (!options.writeBaselinePath.empty() && !writeBaseline(options.writeBaselinePath, report)) status = 1;
+    return status;
+}
@@ -0,0 +1,138 @@
+#include "file_detector.h"
+#include <fstream>
+#include <iostream>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+bool MappedFile::open(const string& path) {
+    close();
+
+#ifndef _WIN32
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        cerr << "Error: Could not open file " << path << "\n";
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        cerr << "Error: Could not read file " << path << "\n";
+        ::close(fd);
+        return false;
+    }
+    if (info.st_size == 0) {   // nothing to map
+        ::close(fd);
+        return true;
+    }
+
+    size_t fileSize = static_cast<size_t>(info.st_size);
+    void* mapped = mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED) {
+        cerr << "Error: Could not map file " << path << "\n";
+        return false;
+    }
+    madvise(mapped, fileSize, MADV_SEQUENTIAL);
+
+    mapping = mapped;
+    bytes = static_cast<const char*>(mapped);
+    length = fileSize;
+    return true;
+#else
+    // No mmap here: read the file into memory instead
+    ifstream file(path, ios::binary);
+    if (!file.is_open()) {
+        cerr << "Error: Could not open file " << path << "\n";
+        return false;
+    }
+    owned.assign(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+    bytes = owned.data();
+    length = owned.size();
+    return true;
+#endif
+}
+
+void MappedFile::close() {
+#ifndef _WIN32
+    if (mapping) munmap(mapping, length);
+#endif
+    mapping = nullptr;
+    owned.clear();
+    owned.shrink_to_fit();
+    bytes = nullptr;
+    length = 0;
+}
+
+void MappedFile::discardBefore(size_t end) {
+#ifndef _WIN32
+    if (!mapping) return;
+    long pageSize = sysconf(_SC_PAGESIZE);
+    size_t pages = end / static_cast<size_t>(pageSize) * static_cast<size_t>(pageSize);
+    if (pages) madvise(mapping, pages, MADV_DONTNEED);
+#else
+    (void)end;
+#endif
+}
+
+bool detectFile(const string& path, const DictionaryImage& dictionary, const DetectionOptions& options,
+                DetectionResult* result, const FileProgress& progress) {
+    MappedFile file;
+    if (!file.open(path)) return false;
+
+    DetectionOptions fileOptions = options;
+    fileOptions.recordContributors = false;
+    StreamingDetector detector(dictionary, fileOptions);
+
+    size_t total = file.size();
+    for (size_t offset = 0; offset < total && !detector.done();) {
+        size_t length = min(FILE_CHUNK_BYTES, total - offset);
+        detector.feed(string_view(file.data() + offset, length));
+        offset += length;
+        file.discardBefore(offset);
+        if (progress) progress(offset, total);
+    }
+    *result = detector.finish();
+    return true;
+}
+
+bool readFilePreview(const string& path, size_t limit, string* preview, bool* truncated) {
+    ifstream file(path, ios::binary);
+    if (!file.is_open()) {
+        cerr << "Error: Could not open file " << path << "\n";
+        return false;
+    }
+
+    // One byte more than the limit tells whether the file goes on
+    preview->resize(limit + 1);
+    file.read(&(*preview)[0], static_cast<streamsize>(limit + 1));
+    preview->resize(static_cast<size_t>(file.gcount()));
+    *truncated = preview->size() > limit;
+    if (!*truncated) return true;
+
+    preview->resize(limit);
+    size_t lineEnd = preview->rfind('\n');
+    if (lineEnd != string::npos) {
+        preview->resize(lineEnd + 1);
+    } else {
+        // Drop a character the limit cut through
+        size_t lead = preview->size();
+        while (lead > 0 && (static_cast<unsigned char>((*preview)[lead - 1]) & 0xC0) == 0x80) --lead;
+        if (lead > 0) {
+            unsigned char c = static_cast<unsigned char>((*preview)[lead - 1]);
+            size_t needed = c >= 0xF0 ? 4 : c >= 0xE0 ? 3 : c >= 0xC0 ? 2 : 1;
+            if (preview->size() - (lead - 1) < needed) preview->resize(lead - 1);
+        }
+    }
+    return true;
+}
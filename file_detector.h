@@ -0,0 +1,58 @@
+#ifndef FILE_DETECTOR_H
+#define FILE_DETECTOR_H
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+#include "language_detector.h"
+
+// A read-only view of a whole file. Mapped into memory where the platform
+// allows, so the bytes are paged in from the file as they are read instead
+// of being copied up front; elsewhere the file is read into a buffer.
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // Returns false, with a message on stderr, if the file cannot be read
+    bool open(const std::string& path);
+    void close();
+
+    const char* data() const { return bytes; }
+    size_t size() const { return length; }
+
+    // Tells the system the bytes before `end` will not be read again, so a
+    // pass over a large file does not keep all of it resident
+    void discardBefore(size_t end);
+
+private:
+    const char* bytes = nullptr;
+    size_t length = 0;
+    void* mapping = nullptr;
+    std::vector<char> owned;   // when the file could not be mapped
+};
+
+// Reports how many bytes of the file have been detected out of its size.
+// Called on the detecting thread after every chunk.
+using FileProgress = std::function<void(size_t done, size_t total)>;
+
+// Bytes fed to detection between progress reports
+const size_t FILE_CHUNK_BYTES = 1 << 20;
+
+// Detects a file of any size by mapping it and streaming it through a
+// StreamingDetector in chunks. Contributor spans are never recorded, since
+// they would outgrow the file itself. Returns false if the file cannot be
+// read; a cancelled run returns true with result->cancelled set.
+bool detectFile(const std::string& path, const DictionaryImage& dictionary, const DetectionOptions& options,
+                DetectionResult* result, const FileProgress& progress = nullptr);
+
+// The first bytes of a file, at most `limit`, cut at the last line break (or
+// character boundary) so the preview ends on whole UTF-8 characters.
+// `truncated` is set when the file is longer than the preview.
+bool readFilePreview(const std::string& path, size_t limit, std::string* preview, bool* truncated);
+
+#endif
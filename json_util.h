@@ -0,0 +1,31 @@
+#ifndef JSON_UTIL_H
+#define JSON_UTIL_H
+
+#include <cstdio>
+#include <string>
+
+// Escapes a UTF-8 string for use inside a JSON string literal
+inline std::string jsonEscape(const std::string& text) {
+    std::string escaped;
+    escaped.reserve(text.size());
+    for (char ch : text) {
+        switch (ch) {
+            case '"':  escaped += "\\\""; break;
+            case '\\': escaped += "\\\\"; break;
+            case '\n': escaped += "\\n"; break;
+            case '\r': escaped += "\\r"; break;
+            case '\t': escaped += "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(ch) < 0x20) {
+                    char buffer[8];
+                    std::snprintf(buffer, sizeof(buffer), "\\u%04x", static_cast<unsigned char>(ch));
+                    escaped += buffer;
+                } else {
+                    escaped += ch;
+                }
+        }
+    }
+    return escaped;
+}
+
+#endif
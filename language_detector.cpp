@@ -0,0 +1,574 @@
+#include "language_detector.h"
+#include "json_util.h"
+#include "normalize.h"
+#include "thread_pool.h"
+#include "tokenizer.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+using namespace std;
+
+// Function to load words from a file into one language of the dictionary
+bool loadWordsFromFile(const string& filename, MultiLanguageTrie* trie, int language, size_t* wordCount) {
+    ifstream file(filename);
+    if (!file.is_open()) {
+        cerr << "Error: Could not open file " << filename << "\n";
+        return false;
+    }
+
+    string word;
+    size_t words = 0;
+    while (getline(file, word)) {
+        trie->insert(word, language);
+        ++words;
+    }
+    if (wordCount) *wordCount = words;
+
+    file.close();
+    return true;
+}
+
+namespace {
+
+// One word list read into the keys of the trie, sorted for insertSorted()
+struct ParsedWordList {
+    bool ok = false;
+    size_t words = 0;
+    double seconds = 0.0;
+    vector<TrieEntry> entries;
+};
+
+void parseWordList(const string& filename, ParsedWordList* list) {
+    auto start = chrono::steady_clock::now();
+    ifstream file(filename, ios::binary);
+    if (!file.is_open()) {
+        cerr << "Error: Could not open file " << filename << "\n";
+        return;
+    }
+    string text((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+
+    // Lines as getline() would split them, including a trailing empty word
+    // only when the file does not end with a newline
+    for (size_t begin = 0; begin < text.size();) {
+        size_t end = text.find('\n', begin);
+        if (end == string::npos) end = text.size();
+        MultiLanguageTrie::wordEntries(text.substr(begin, end - begin), &list->entries);
+        ++list->words;
+        begin = end + 1;
+    }
+    MultiLanguageTrie::sortEntries(&list->entries);
+    list->ok = true;
+    list->seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+} // namespace
+
+bool loadLanguages(MultiLanguageTrie* dictionary, const vector<LanguageSource>& languages, ThreadPool* pool,
+                   const LoadProgress& progress) {
+    vector<int> indices;
+    for (const LanguageSource& source : languages) {
+        int language = dictionary->addLanguage(source.name);
+        if (language < 0) {
+            cerr << "Error: Too many languages, " << source.name << " and later ones are skipped (limit "
+                 << MAX_LANGUAGES << ")\n";
+            return false;
+        }
+        indices.push_back(language);
+    }
+
+    // Reading, normalizing and sorting each list is independent work; only
+    // the trie is shared, so it is filled afterwards in manifest order
+    unique_ptr<ThreadPool> ownPool;
+    if (!pool) {
+        ownPool.reset(new ThreadPool(min<size_t>(max<size_t>(languages.size(), 1), thread::hardware_concurrency())));
+        pool = ownPool.get();
+    }
+    vector<ParsedWordList> lists(languages.size());
+    mutex progressMutex;
+    size_t parsed = 0;
+    for (size_t i = 0; i < languages.size(); ++i) {
+        pool->submit([&, i] {
+            parseWordList(languages[i].wordList, &lists[i]);
+            if (!progress) return;
+            lock_guard<mutex> lock(progressMutex);
+            progress(languages[i].name, ++parsed, languages.size());
+        });
+    }
+    pool->wait();
+
+    bool ok = true;
+    for (size_t i = 0; i < languages.size(); ++i) {
+        ParsedWordList& list = lists[i];
+        ok = list.ok && ok;
+#if defined(LANGWITCH_ENABLE_STATS)
+        detection_stats::LanguageLoad load;
+        load.name = languages[i].name;
+        load.words = list.words;
+        size_t nodesBefore = dictionary->nodeCount();
+        size_t bytesBefore = dictionary->memoryUsage();
+        auto start = chrono::steady_clock::now();
+        dictionary->insertSorted(list.entries, indices[i]);
+        load.loadSeconds = list.seconds + chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        load.trieNodes = dictionary->nodeCount() - nodesBefore;
+        load.trieBytes = dictionary->memoryUsage() - bytesBefore;
+        detection_stats::recordLanguageLoad(load);
+#else
+        dictionary->insertSorted(list.entries, indices[i]);
+#endif
+        vector<TrieEntry>().swap(list.entries);
+    }
+    return ok;
+}
+
+bool buildDictionary(DictionaryImage* image, const string& directory, ThreadPool* pool,
+                     const LoadProgress& progress) {
+    vector<LanguageSource> languages;
+    if (!discoverLanguages(directory, &languages)) return false;
+
+    MultiLanguageTrie trie;
+    bool ok = loadLanguages(&trie, languages, pool, progress);
+    return image->loadFromBuffer(DictionaryImage::compile(trie)) && ok;
+}
+
+unsigned editBudget(size_t length, unsigned maxEditDistance) {
+    unsigned budget = length < 3 ? 0 : length < 6 ? 1 : 2;
+    return budget < maxEditDistance ? budget : maxEditDistance;
+}
+
+// A word matched with one typo counts half as much as an exact match (a
+// quarter with two), and an n-gram guess counts half
+static const double FUZZY_WEIGHT = 0.5;
+static const double NGRAM_WEIGHT = 0.5;
+
+// N-gram guesses on shorter words are mostly noise
+static const size_t NGRAM_MIN_LENGTH = 3;
+
+WordScorer::WordScorer(const DictionaryImage& dictionary, const DetectionOptions& options)
+    : dictionary(dictionary),
+      languageCount(dictionary.languageCount()),
+      maxEditDistance(options.maxEditDistance),
+      ngrams(options.ngrams),
+      cache(options.cache) {
+    // A profile for a different dictionary would score the wrong languages
+    if (ngrams && ngrams->languageCount() != languageCount) ngrams = nullptr;
+}
+
+void WordScorer::normalize(std::string_view word) {
+    LANGWITCH_STATS_TIME(statCounters, NORMALIZE);
+    normalized.resize(word.size());
+    normalized.resize(normalizeWordInto(word.data(), word.size(), &normalized[0]));
+}
+
+// Normalizes the token into `normalized` and finds the languages it belongs
+// to, retrying with typos if it matches nothing exactly
+WordMatch WordScorer::lookup(std::string_view word) {
+    WordMatch match;
+    normalize(word);
+    if (normalized.empty()) return match;  // digits only, nothing to look up
+
+    // The token is already normalized, so one walk covers both the exact
+    // and the normalized match for every language
+    {
+        LANGWITCH_STATS_TIME(statCounters, LOOKUP);
+        match.languages = dictionary.lookup(normalized).any();
+    }
+    if (match.languages) {
+        match.kind = WordMatch::EXACT;
+        return match;
+    }
+    unsigned budget = editBudget(normalized.size(), maxEditDistance);
+    unsigned distance = 0;
+    if (budget) {
+        LANGWITCH_STATS_TIME(statCounters, FUZZY);
+        match.languages = dictionary.fuzzyLookup(normalized, budget, &distance);
+    }
+    if (match.languages) {
+        match.kind = WordMatch::FUZZY;
+        match.distance = static_cast<uint8_t>(distance);
+    }
+    return match;
+}
+
+bool WordScorer::score(std::string_view word, WordScore* score) {
+    WordMatch match;
+    bool normalizedReady = false;
+    bool cached = false;
+    if (cache) {
+        LANGWITCH_STATS_TIME(statCounters, LOOKUP);
+        cached = cache->find(word, match);
+    }
+    if (cached) {
+        ++cacheHits;
+    } else {
+        match = lookup(word);
+        normalizedReady = true;
+        if (cache) {
+            ++cacheMisses;
+            cache->insert(word, match);
+        }
+    }
+
+    score->kind = match.kind;
+    score->languages = match.languages;
+    if (match.kind == WordMatch::NONE) return guess(word, normalizedReady, score);
+
+    double weight = match.kind == WordMatch::FUZZY ? FUZZY_WEIGHT / match.distance : 1.0;
+    for (LanguageMask bits = match.languages; bits; bits &= bits - 1) score->weights[__builtin_ctzll(bits)] = weight;
+    // A typo close to words of several languages is split between them by
+    // how much it looks like each
+    if (match.kind == WordMatch::FUZZY && (match.languages & (match.languages - 1))) {
+        apportion(word, normalizedReady, score);
+    }
+
+    // Every matched language gets its weight on the diagonal and every pair
+    // shares half the smaller of theirs
+    score->evidence = 0.0;
+    for (LanguageMask rows = match.languages; rows; rows &= rows - 1) {
+        size_t row = static_cast<size_t>(__builtin_ctzll(rows));
+        score->evidence += score->weights[row];
+        for (LanguageMask cols = rows & (rows - 1); cols; cols &= cols - 1) {
+            score->evidence += 0.5 * std::min(score->weights[row], score->weights[__builtin_ctzll(cols)]);
+        }
+    }
+    return true;
+}
+
+// Scales the weights of a typo match by the n-gram probability of each
+// matched language relative to the likeliest of them
+void WordScorer::apportion(std::string_view word, bool normalizedReady, WordScore* score) {
+    if (!ngrams) return;
+    if (!normalizedReady) normalize(word);
+
+    float probabilities[MAX_LANGUAGES];
+    {
+        LANGWITCH_STATS_TIME(statCounters, NGRAM);
+        if (!ngrams->score(normalized, probabilities)) return;
+    }
+    float best = 0.0f;
+    for (LanguageMask bits = score->languages; bits; bits &= bits - 1) {
+        best = std::max(best, probabilities[__builtin_ctzll(bits)]);
+    }
+    if (best <= 0.0f) return;
+    for (LanguageMask bits = score->languages; bits; bits &= bits - 1) {
+        size_t i = static_cast<size_t>(__builtin_ctzll(bits));
+        score->weights[i] *= probabilities[i] / best;
+    }
+}
+
+// Spreads an n-gram guess for a word found nowhere over the diagonal
+bool WordScorer::guess(std::string_view word, bool normalizedReady, WordScore* score) {
+    if (!ngrams) return false;
+    if (!normalizedReady) normalize(word);
+    if (normalized.size() < NGRAM_MIN_LENGTH) return false;
+
+    float probabilities[MAX_LANGUAGES];
+    {
+        LANGWITCH_STATS_TIME(statCounters, NGRAM);
+        if (!ngrams->score(normalized, probabilities)) return false;
+    }
+    size_t likeliest = 0;
+    for (size_t i = 0; i < languageCount; ++i) {
+        score->weights[i] = NGRAM_WEIGHT * probabilities[i];
+        if (probabilities[i] > probabilities[likeliest]) likeliest = i;
+    }
+    score->languages = LanguageMask(1) << likeliest;
+    score->evidence = NGRAM_WEIGHT;
+    return true;
+}
+
+void WordScorer::finish(size_t bytes, size_t tokens) {
+    if (cache) cache->recordLookups(cacheHits, cacheMisses);
+    cacheHits = cacheMisses = 0;
+#if defined(LANGWITCH_ENABLE_STATS)
+    statCounters.documents = 1;
+    statCounters.bytes = bytes;
+    statCounters.tokens = tokens;
+    detection_stats::flush(statCounters);
+    statCounters = detection_stats::Counters();
+#else
+    (void)bytes;
+    (void)tokens;
+#endif
+}
+
+// True if the text contains an ASCII letter or a UTF-8 lead byte
+static bool hasAlphabetic(std::string_view text) {
+    for (unsigned char c : text) {
+        if ((c >= 0xC0 && c <= 0xF7) || isalpha(c)) return true;
+    }
+    return false;
+}
+
+// Sets the verdict from a finished matrix and evidence total
+static void chooseLanguage(DetectionResult* result, bool sawAlphabetic) {
+    // Empty or non-alphabetic input
+    if (!sawAlphabetic || result->languages.empty()) {
+        result->language = "Unknown";
+        result->confidence = 0.0;
+        return;
+    }
+
+    // Find best language; ties go to the language registered first
+    size_t best = 0;
+    double maxDiagonal = -1;
+    for (size_t i = 0; i < result->languages.size(); ++i) {
+        if (result->at(i, i) > maxDiagonal) {
+            maxDiagonal = result->at(i, i);
+            best = i;
+        }
+    }
+
+    result->language = result->languages[best];
+    result->confidence = (result->evidence > 0) ? result->at(best, best) / result->evidence : 0.0;
+}
+
+size_t DetectionResult::languageIndex(const std::string& name) const {
+    for (size_t i = 0; i < languages.size(); ++i) {
+        if (languages[i] == name) return i;
+    }
+    return languages.size();
+}
+
+std::set<std::string> DetectionResult::contributors(size_t row, size_t col, std::string_view input) const {
+    std::set<std::string> words;
+    LanguageMask wanted = (LanguageMask(1) << row) | (LanguageMask(1) << col);
+    for (const TokenSpan& span : contributorSpans) {
+        if ((span.languages & wanted) == wanted && span.offset + span.length <= input.size()) {
+            words.emplace(input.substr(span.offset, span.length));
+        }
+    }
+    return words;
+}
+
+std::vector<WordFrequency> DetectionResult::wordFrequencies(std::string_view input) const {
+    std::unordered_map<std::string_view, size_t> index;
+    std::vector<WordFrequency> words;
+    for (const TokenSpan& span : contributorSpans) {
+        if (span.offset + span.length > input.size()) continue;
+        std::string_view word = input.substr(span.offset, span.length);
+        auto found = index.emplace(word, words.size());
+        if (found.second) {
+            words.emplace_back();
+            words.back().word.assign(word);
+        }
+        WordFrequency& entry = words[found.first->second];
+        ++entry.count;
+        entry.languages |= span.languages;
+    }
+
+    std::sort(words.begin(), words.end(), [](const WordFrequency& a, const WordFrequency& b) {
+        return a.count != b.count ? a.count > b.count : a.word < b.word;
+    });
+    return words;
+}
+
+StreamingDetector::StreamingDetector(const DictionaryImage& dictionary, const DetectionOptions& options)
+    : options(options), scorer(dictionary, options) {
+    size_t count = dictionary.languageCount();
+    for (size_t i = 0; i < count; ++i) {
+        result.languages.push_back(std::string(dictionary.getLanguageName(i)));
+    }
+    result.matrix.assign(count * count, 0.0);
+}
+
+bool StreamingDetector::feed(std::string_view chunk) {
+    if (stopped) return false;
+    if (options.cancel && options.cancel->load(std::memory_order_relaxed)) {
+        stopped = true;
+        result.cancelled = true;
+        return false;
+    }
+    if (!sawAlphabetic) sawAlphabetic = hasAlphabetic(chunk);
+
+    tokens.feed(chunk);
+    std::string_view word;
+    size_t offset;
+    while (!stopped && nextWord(word, offset)) processToken(word, offset);
+    return !stopped;
+}
+
+bool StreamingDetector::nextWord(std::string_view& word, size_t& offset) {
+    LANGWITCH_STATS_TIME(scorer.stats(), TOKENIZE);
+    return tokens.next(word, offset);
+}
+
+void StreamingDetector::processToken(std::string_view word, size_t offset) {
+    ++result.tokensConsumed;
+    if (options.cancel && (result.tokensConsumed & (DetectionOptions::CANCEL_POLL_INTERVAL - 1)) == 0 &&
+        options.cancel->load(std::memory_order_relaxed)) {
+        stopped = true;
+        result.cancelled = true;
+        return;
+    }
+
+    WordScore score;
+    if (!scorer.score(word, &score)) return;
+    LANGWITCH_STATS_TIME(scorer.stats(), MATRIX);
+
+    size_t count = result.languages.size();
+    if (score.kind == WordMatch::NONE) {
+        for (size_t i = 0; i < count; ++i) result.matrix[i * count + i] += score.weights[i];
+    } else {
+        for (LanguageMask rows = score.languages; rows; rows &= rows - 1) {
+            size_t row = static_cast<size_t>(__builtin_ctzll(rows));
+            double* cells = &result.matrix[row * count];
+            cells[row] += score.weights[row];
+            for (LanguageMask cols = score.languages & ~(LanguageMask(1) << row); cols; cols &= cols - 1) {
+                size_t col = static_cast<size_t>(__builtin_ctzll(cols));
+                cells[col] += 0.5 * std::min(score.weights[row], score.weights[col]);
+            }
+        }
+    }
+    upperTotal += score.evidence;
+
+    if (options.recordContributors) {
+        result.contributorSpans.push_back({offset, static_cast<uint32_t>(word.size()), score.languages});
+    }
+
+    if (options.earlyExit && result.tokensConsumed >= options.minTokens && leaderIsSafe()) {
+        stopped = true;
+        result.stoppedEarly = true;
+    }
+}
+
+// The leader is safe once its running confidence reaches the target and it
+// beats the runner-up by `marginZ` standard deviations. Under the hypothesis
+// that both languages match equally often, the difference of their counts
+// has a standard deviation of about sqrt(a + b) (a sign test).
+bool StreamingDetector::leaderIsSafe() const {
+    double leader = 0.0, runnerUp = 0.0;
+    for (size_t i = 0; i < result.languages.size(); ++i) {
+        double count = result.at(i, i);
+        if (count > leader) {
+            runnerUp = leader;
+            leader = count;
+        } else if (count > runnerUp) {
+            runnerUp = count;
+        }
+    }
+    if (leader <= runnerUp || upperTotal <= 0) return false;
+
+    double confidence = leader / upperTotal;
+    return confidence >= options.targetConfidence &&
+           leader - runnerUp >= options.marginZ * std::sqrt(leader + runnerUp);
+}
+
+DetectionResult StreamingDetector::finish() {
+    std::string_view word;
+    size_t offset;
+    if (tokens.finish(word, offset) && !stopped) processToken(word, offset);
+    stopped = true;
+    result.evidence = upperTotal;
+    scorer.finish(tokens.size(), result.tokensConsumed);
+
+    chooseLanguage(&result, sawAlphabetic);
+    return result;
+}
+
+IncrementalDetector::IncrementalDetector(const DictionaryImage& dictionary, const DetectionOptions& options)
+    : dictionary(dictionary), options(options) {
+    // Early exit depends on word order across lines, which sums lose
+    this->options.earlyExit = false;
+}
+
+bool IncrementalDetector::update(std::string_view text, DetectionResult* result, const std::atomic<bool>* cancel) {
+    DetectionOptions lineOptions = options;
+    lineOptions.cancel = cancel;
+
+    *result = DetectionResult();
+    size_t count = dictionary.languageCount();
+    for (size_t i = 0; i < count; ++i) result->languages.push_back(std::string(dictionary.getLanguageName(i)));
+    result->matrix.assign(count * count, 0.0);
+
+    std::unordered_map<std::string, Line> current;
+    bool alphabetic = false;
+    detectedLines = 0;
+    for (size_t start = 0; start < text.size();) {
+        size_t end = text.find('\n', start);
+        if (end == std::string_view::npos) end = text.size();
+        std::string key(text.substr(start, end - start));
+
+        // Reuse the line from the previous text, or from earlier in this one
+        auto found = current.find(key);
+        if (found == current.end()) {
+            auto previous = lines.find(key);
+            if (previous != lines.end()) {
+                found = current.emplace(key, std::move(previous->second)).first;
+                lines.erase(previous);
+            } else {
+                Line line;
+                line.alphabetic = hasAlphabetic(key);
+                StreamingDetector detector(dictionary, lineOptions);
+                detector.feed(key);
+                line.result = detector.finish();
+                if (line.result.cancelled) {
+                    // Hand back the lines taken so far, so a cancelled
+                    // update (every keystroke in live mode) keeps the cache
+                    for (auto& entry : current) lines.emplace(entry.first, std::move(entry.second));
+                    return false;
+                }
+                ++detectedLines;
+                found = current.emplace(key, std::move(line)).first;
+            }
+        }
+
+        const Line& line = found->second;
+        alphabetic = alphabetic || line.alphabetic;
+        for (size_t i = 0; i < result->matrix.size(); ++i) result->matrix[i] += line.result.matrix[i];
+        result->evidence += line.result.evidence;
+        result->tokensConsumed += line.result.tokensConsumed;
+        for (TokenSpan span : line.result.contributorSpans) {
+            span.offset += start;
+            result->contributorSpans.push_back(span);
+        }
+        start = end + 1;
+    }
+    lines.swap(current);
+
+    chooseLanguage(result, alphabetic);
+    return true;
+}
+
+// Function to detect the language of a given input
+DetectionResult detectLanguageWithMatrix(
+    const std::string& input,
+    const DictionaryImage& dictionary,
+    const DetectionOptions& options
+) {
+    StreamingDetector detector(dictionary, options);
+    detector.feed(input);
+    return detector.finish();
+}
+
+void writeResultJson(std::ostream& out, const DetectionResult& result, bool includeMatrix,
+                     const std::string& source) {
+    out << "{";
+    if (!source.empty()) out << "\"source\":\"" << jsonEscape(source) << "\",";
+    out << "\"language\":\"" << jsonEscape(result.language) << "\""
+        << ",\"confidence\":" << result.confidence
+        << ",\"tokens\":" << result.tokensConsumed;
+    if (result.stoppedEarly) out << ",\"stopped_early\":true";
+
+    if (includeMatrix) {
+        out << ",\"matrix\":{";
+        for (size_t row = 0; row < result.languages.size(); ++row) {
+            if (row) out << ",";
+            out << "\"" << jsonEscape(result.languages[row]) << "\":{";
+            for (size_t col = 0; col < result.languages.size(); ++col) {
+                if (col) out << ",";
+                out << "\"" << jsonEscape(result.languages[col]) << "\":" << result.at(row, col);
+            }
+            out << "}";
+        }
+        out << "}";
+    }
+    out << "}";
+}
@@ -0,0 +1,269 @@
+#ifndef LANGUAGE_DETECTOR_H
+#define LANGUAGE_DETECTOR_H
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <set>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "detection_stats.h"
+#include "dictionary_image.h"
+#include "language_registry.h"
+#include "multi_language_trie.h"
+#include "ngram_profile.h"
+#include "tokenizer.h"
+#include "word_cache.h"
+
+// A matched word, as a byte range of the input, with the languages it
+// matched
+struct TokenSpan {
+    size_t offset;
+    uint32_t length;
+    LanguageMask languages;
+};
+
+// A distinct word among the contributors, how often it occurred and the
+// languages it matched
+struct WordFrequency {
+    std::string word;
+    size_t count = 0;
+    LanguageMask languages = 0;
+};
+
+// Structure to hold detection results including matrix and contributors.
+//
+// The matrix is dense and indexed by language (the order of `languages`):
+// every matched word adds 1 to the diagonal cell of each language it belongs
+// to and 0.5 to the cell of every pair of those languages (less for a typo
+// match, see WordScore). Contributors are kept as spans into the input and
+// only turned into strings on request.
+//
+// `language` has the largest diagonal cell. Ties go to the language
+// registered first, i.e. listed first in the manifest, so equal evidence
+// always gives the same verdict.
+struct DetectionResult {
+    std::string language;
+    double confidence = 0.0;
+    std::vector<std::string> languages;
+    std::vector<double> matrix;              // languages.size() squared, row-major
+    std::vector<TokenSpan> contributorSpans; // one per matched word, in input order
+    double evidence = 0.0;       // matrix sum on and above the diagonal; confidence is a share of it
+    size_t tokensConsumed = 0;   // words read before detection finished
+    bool stoppedEarly = false;   // true if early exit skipped the rest of the input
+    bool cancelled = false;      // true if DetectionOptions::cancel stopped detection
+
+    size_t languageCount() const { return languages.size(); }
+
+    double at(size_t row, size_t col) const { return matrix[row * languages.size() + col]; }
+
+    // Index of the named language, or languageCount() if unknown
+    size_t languageIndex(const std::string& name) const;
+
+    // Distinct words that contributed to a cell, read back from the input
+    // that was detected
+    std::set<std::string> contributors(size_t row, size_t col, std::string_view input) const;
+
+    // Every distinct contributing word with its count, most frequent first
+    // (ties in byte order), from one pass over the spans. A view that only
+    // lists the top words of each cell can filter this by `languages`.
+    std::vector<WordFrequency> wordFrequencies(std::string_view input) const;
+};
+
+// Controls how much of the input detection reads
+struct DetectionOptions {
+    // Stop as soon as the leading language is statistically safe instead of
+    // reading every word. Checked only after `minTokens` words; the leader
+    // must reach `targetConfidence` and beat the runner-up by `marginZ`
+    // standard deviations.
+    bool earlyExit = false;
+    size_t minTokens = 50;
+    double targetConfidence = 0.0;
+    double marginZ = 3.0;
+
+    // Keep a span per matched word so DetectionResult::contributors() works.
+    // Turn off for large inputs where only the verdict and matrix matter.
+    bool recordContributors = true;
+
+    // Words found in no dictionary are retried with up to this many typos
+    // (0 turns the fallback off, at most DictionaryImage::MAX_EDIT_DISTANCE).
+    // Short words get fewer: none below 3 letters, one below 6, so "a" or
+    // "le" cannot match half the dictionary. A typo match counts half, or a
+    // quarter with two typos; with `ngrams`, a typo close to words of
+    // several languages is split between them by how much it looks like each.
+    unsigned maxEditDistance = 2;
+
+    // Words that still match nothing are scored by their letter n-grams,
+    // when a profile built from the same dictionary is given. The guess is
+    // spread over the diagonal by probability and counts half in total.
+    const NgramProfile* ngrams = nullptr;
+
+    // Remembers how recent tokens matched so repeated words skip
+    // normalization and every dictionary walk. May be shared by any number
+    // of threads; see WordCache for when a cache can be reused.
+    WordCache* cache = nullptr;
+
+    // Polled every CANCEL_POLL_INTERVAL words; once it is set, detection
+    // stops and the result is marked cancelled. Lets a UI abandon a
+    // superseded request.
+    const std::atomic<bool>* cancel = nullptr;
+
+    // Words between polls of `cancel`, a power of two
+    static const size_t CANCEL_POLL_INTERVAL = 256;
+};
+
+// Typos allowed for a normalized word of the given length
+unsigned editBudget(size_t length, unsigned maxEditDistance);
+
+// Function to load words from a file into one language of the dictionary.
+// Returns false if the file could not be opened; `wordCount`, if given,
+// receives the number of lines read.
+bool loadWordsFromFile(const std::string& filename, MultiLanguageTrie* trie, int language,
+                       size_t* wordCount = nullptr);
+
+class ThreadPool;
+
+// Reports that the word list of `language` has been read, the `loaded`th of
+// `total`. Called from pool threads, one call at a time.
+using LoadProgress = std::function<void(const std::string& language, size_t loaded, size_t total)>;
+
+// Registers each language, in order, and loads its word list. The lists are
+// read, normalized and sorted in parallel on `pool` (a temporary pool with a
+// thread per language when null), then bulk-inserted. Returns false if a
+// word list was missing or there are more than MAX_LANGUAGES.
+bool loadLanguages(MultiLanguageTrie* dictionary, const std::vector<LanguageSource>& languages,
+                   ThreadPool* pool = nullptr, const LoadProgress& progress = nullptr);
+
+// Discovers the languages of a data directory (see discoverLanguages), loads
+// them and compiles them into a dictionary image. The intermediate trie is
+// freed once the image is built.
+bool buildDictionary(DictionaryImage* image, const std::string& directory, ThreadPool* pool = nullptr,
+                     const LoadProgress& progress = nullptr);
+
+// What one word counts for each language. A dictionary match (kind EXACT
+// or FUZZY) adds weights[i] to the diagonal cell of each matched language i
+// and half the smaller weight of every pair of them off the diagonal. A word
+// found nowhere but guessed from its n-grams (kind NONE) only adds weights[i]
+// to the diagonal of every language, and `languages` holds its likeliest
+// one. `evidence` is what the word adds on and above the diagonal.
+struct WordScore {
+    WordMatch::Kind kind = WordMatch::NONE;
+    LanguageMask languages = 0;
+    double evidence = 0.0;
+    double weights[MAX_LANGUAGES];   // the dictionary's languages
+};
+
+// Scores words the same way for every detector: the word cache, then the
+// exact lookup of the normalized word, the typo fallback and the n-gram
+// guess. Keeps the cache hit counts and, when compiled in, stage timings of
+// one document. Not thread-safe; use one per detector.
+class WordScorer {
+public:
+    WordScorer(const DictionaryImage& dictionary, const DetectionOptions& options);
+
+    // Scores one token. Returns false if it is no evidence for any language.
+    bool score(std::string_view word, WordScore* score);
+
+    // Records the cache lookups in options.cache and, with statistics
+    // compiled in, adds the document of `bytes` and `tokens` to the totals
+    void finish(size_t bytes, size_t tokens);
+
+#if defined(LANGWITCH_ENABLE_STATS)
+    detection_stats::Counters& stats() { return statCounters; }
+#endif
+
+private:
+    void normalize(std::string_view word);
+    WordMatch lookup(std::string_view word);
+    bool guess(std::string_view word, bool normalizedReady, WordScore* score);
+    void apportion(std::string_view word, bool normalizedReady, WordScore* score);
+
+    const DictionaryImage& dictionary;
+    size_t languageCount;
+    unsigned maxEditDistance;
+    const NgramProfile* ngrams;     // null unless built for this dictionary
+    WordCache* cache;
+    std::string normalized;         // scratch buffer reused for every token
+    uint64_t cacheHits = 0;         // recorded by finish()
+    uint64_t cacheMisses = 0;
+#if defined(LANGWITCH_ENABLE_STATS)
+    detection_stats::Counters statCounters;   // flushed by finish()
+#endif
+};
+
+// Incremental detection over input that arrives in pieces (a stream, a file
+// read in chunks). A word split across two chunks is joined before lookup;
+// runs longer than ChunkTokenizer::MAX_WORD_BYTES are not words and are
+// skipped, so the bytes held between chunks stay bounded.
+class StreamingDetector {
+public:
+    StreamingDetector(const DictionaryImage& dictionary, const DetectionOptions& options = DetectionOptions());
+
+    // Processes the next piece of input. Returns false once early exit has
+    // triggered; the caller can stop reading, further input is ignored.
+    bool feed(std::string_view chunk);
+
+    bool done() const { return stopped; }
+
+    // Processes any held-back word and returns the result
+    DetectionResult finish();
+
+private:
+    bool nextWord(std::string_view& word, size_t& offset);
+    void processToken(std::string_view word, size_t offset);
+    bool leaderIsSafe() const;
+
+    DetectionOptions options;
+    DetectionResult result;
+    WordScorer scorer;
+    ChunkTokenizer tokens;
+    double upperTotal = 0.0;        // matrix sum on and above the diagonal
+    bool sawAlphabetic = false;
+    bool stopped = false;
+};
+
+// Re-detects text that changes a little at a time, such as a document being
+// typed. Each line is detected on its own and remembered by its content, so
+// update() only reads the lines that changed since the previous call and sums
+// the rest. Words never span a newline, so the result matches detecting the
+// whole text (early exit is not applied). Not thread-safe.
+class IncrementalDetector {
+public:
+    IncrementalDetector(const DictionaryImage& dictionary, const DetectionOptions& options = DetectionOptions());
+
+    // Detects `text` into `result`. Returns false, leaving `result`
+    // incomplete, if `cancel` was set meanwhile.
+    bool update(std::string_view text, DetectionResult* result, const std::atomic<bool>* cancel = nullptr);
+
+    // Lines the last update() had to detect
+    size_t linesDetected() const { return detectedLines; }
+
+private:
+    struct Line {
+        DetectionResult result;
+        bool alphabetic = false;
+    };
+
+    const DictionaryImage& dictionary;
+    DetectionOptions options;
+    std::unordered_map<std::string, Line> lines;   // by content, lines of the last completed text
+                                                   // and of any update cancelled since
+    size_t detectedLines = 0;
+};
+
+// Function to detect the language of a given input
+DetectionResult detectLanguageWithMatrix(
+    const std::string& input,
+    const DictionaryImage& dictionary,
+    const DetectionOptions& options = DetectionOptions()
+);
+
+// Writes the result as a single-line JSON object, optionally with the matrix.
+// A non-empty source (file name, line number...) is included as "source".
+void writeResultJson(std::ostream& out, const DetectionResult& result, bool includeMatrix,
+                     const std::string& source = "");
+
+#endif
@@ -0,0 +1,127 @@
+#include "language_registry.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+using namespace std;
+namespace fs = std::filesystem;
+
+#ifndef LANGWITCH_DATA_DIR
+#define LANGWITCH_DATA_DIR "."
+#endif
+
+static bool readManifest(const fs::path& manifest, const fs::path& directory,
+                         vector<LanguageSource>* languages) {
+    ifstream file(manifest);
+    if (!file.is_open()) {
+        cerr << "Error: Could not open file " << manifest.string() << "\n";
+        return false;
+    }
+
+    string line;
+    size_t lineNumber = 0;
+    while (getline(file, line)) {
+        ++lineNumber;
+        size_t start = line.find_first_not_of(" \t\r");
+        if (start == string::npos || line[start] == '#') continue;
+        size_t end = line.find_last_not_of(" \t\r") + 1;
+
+        // The file name is the last word; everything before it is the name
+        size_t split = line.find_last_of(" \t", end - 1);
+        size_t nameEnd = (split == string::npos || split < start)
+            ? string::npos : line.find_last_not_of(" \t", split) + 1;
+        if (nameEnd == string::npos) {
+            cerr << "Error: " << manifest.string() << ":" << lineNumber << ": expected \"Name file\"\n";
+            return false;
+        }
+        languages->push_back({line.substr(start, nameEnd - start),
+                              (directory / line.substr(split + 1, end - split - 1)).string()});
+    }
+    return true;
+}
+
+// Build files (CMakeLists.txt, CMakeCache.txt) share the extension of word
+// lists but never are one
+static bool isBuildFile(const fs::path& path) {
+    return path.filename().string().compare(0, 5, "CMake") == 0;
+}
+
+// Lines of a word list hold one word each; prose or a build script has
+// spaces in most of its first lines
+static bool looksLikeWordList(const fs::path& path) {
+    ifstream file(path);
+    string line;
+    size_t lines = 0, spaced = 0;
+    while (lines < 32 && getline(file, line)) {
+        size_t start = line.find_first_not_of(" \t\r");
+        if (start == string::npos) continue;
+        size_t end = line.find_last_not_of(" \t\r");
+        ++lines;
+        if (line.find_first_of(" \t", start) < end) ++spaced;
+    }
+    return spaced * 2 <= lines;
+}
+
+bool discoverLanguages(const string& directory, vector<LanguageSource>* languages) {
+    languages->clear();
+    fs::path root(directory);
+
+    error_code error;
+    if (fs::is_regular_file(root / LANGUAGE_MANIFEST, error)) {
+        if (!readManifest(root / LANGUAGE_MANIFEST, root, languages)) return false;
+    } else {
+        vector<fs::path> wordLists;
+        for (fs::directory_iterator it(root, error), end; !error && it != end; it.increment(error)) {
+            if (it->is_regular_file(error) && it->path().extension() == ".txt" && !isBuildFile(it->path())) {
+                wordLists.push_back(it->path());
+            }
+        }
+        if (error) {
+            cerr << "Error: Could not read directory " << directory << "\n";
+            return false;
+        }
+        sort(wordLists.begin(), wordLists.end());
+        for (const fs::path& path : wordLists) {
+            if (!looksLikeWordList(path)) {
+                cerr << "Error: " << path.string() << " does not look like a word list (one word per line); "
+                     << "list the languages of " << directory << " in a " << LANGUAGE_MANIFEST << "\n";
+                return false;
+            }
+            string name = path.stem().string();
+            if (!name.empty()) name[0] = static_cast<char>(toupper(static_cast<unsigned char>(name[0])));
+            languages->push_back({name, path.string()});
+        }
+    }
+
+    if (languages->empty()) {
+        cerr << "Error: No languages found in " << directory << "\n";
+        return false;
+    }
+    return true;
+}
+
+bool findDataOverride(const string& executablePath, string* directory) {
+    const char* fromEnvironment = getenv("LANGWITCH_DATA_DIR");
+    if (fromEnvironment && *fromEnvironment) {
+        *directory = fromEnvironment;
+        return true;
+    }
+
+    if (!executablePath.empty()) {
+        error_code error;
+        fs::path besideExecutable = fs::absolute(executablePath, error).parent_path();
+        if (!error && fs::is_regular_file(besideExecutable / LANGUAGE_MANIFEST, error)) {
+            *directory = besideExecutable.string();
+            return true;
+        }
+    }
+    return false;
+}
+
+string findDataDirectory(const string& executablePath) {
+    string directory;
+    return findDataOverride(executablePath, &directory) ? directory : LANGWITCH_DATA_DIR;
+}
@@ -0,0 +1,41 @@
+#ifndef LANGUAGE_REGISTRY_H
+#define LANGUAGE_REGISTRY_H
+
+#include <string>
+#include <vector>
+
+// One language to load: its display name and the path of its word list
+struct LanguageSource {
+    std::string name;
+    std::string wordList;
+};
+
+// Name of the optional manifest inside a data directory
+const char* const LANGUAGE_MANIFEST = "languages.manifest";
+
+// Lists the languages of a data directory.
+//
+// If the directory has a languages.manifest, every line that is not blank or
+// a '#' comment reads "Name file", where the file name is the last word and
+// is relative to the directory. Languages keep the manifest order, which is
+// also the order ties are broken in. Without a manifest, every *.txt file is
+// a language named after the file with its first letter capitalized
+// ("english.txt" is "English"), in file name order. Files named CMake* are
+// skipped, and a *.txt file with several words on most of its first lines
+// is taken for prose and needs a manifest to say what the lists are.
+//
+// Returns false, with the reason on stderr, if the directory cannot be read,
+// the manifest is malformed, a *.txt file is not a word list or no language
+// was found.
+bool discoverLanguages(const std::string& directory, std::vector<LanguageSource>* languages);
+
+// A data directory set up for this installation: $LANGWITCH_DATA_DIR if set,
+// else the directory of the executable if it holds a manifest. Returns false
+// if there is neither.
+bool findDataOverride(const std::string& executablePath, std::string* directory);
+
+// Data directory to use when none is given: the override if there is one,
+// else the source tree the library was built from.
+std::string findDataDirectory(const std::string& executablePath);
+
+#endif
@@ -2,89 +2,45 @@
 #define LANGUAGE_TRIE_H
 
 #include <string>
-#include "trie_node.h"
-#include "normalize.h"
+#include "multi_language_trie.h"
 
 using namespace std;
 
+// Dictionary for a single language. A thin view over a MultiLanguageTrie
+// holding just that language; use MultiLanguageTrie directly to look a word
+// up in several languages with one traversal.
 class LanguageTrie {
 private:
-    TrieNode* root;
-    string languageName;
+    MultiLanguageTrie trie;
+    int language;
 
 public:
     // Constructor
-    LanguageTrie(const string& languageName) : languageName(languageName) {
-        root = new TrieNode();
+    LanguageTrie(const string& languageName) {
+        language = trie.addLanguage(languageName);
     }
 
-    // Destructor
-    ~LanguageTrie() {
-        delete root;
-    }
-
-    // Insert normalized version of word
+    // Insert word and its normalized version
     void insert(const string& word) {
-        // Insert exact form
-        TrieNode* current = root;
-        for (char ch : word) {
-            unsigned char index = static_cast<unsigned char>(ch);
-            if (index >= CHAR_SIZE) continue;
-            if (!current->children[index])
-                current->children[index] = new TrieNode(ch);
-            current = current->children[index];
-        }
-        current->isEndOfWord = true;
-
-        // Insert normalized only if different
-        std::string normalized = normalizeWord(word);
-        if (normalized != word) {
-            current = root;
-            for (char ch : normalized) {
-                unsigned char index = static_cast<unsigned char>(ch);
-                if (index >= CHAR_SIZE) continue;
-                if (!current->children[index])
-                    current->children[index] = new TrieNode(ch);
-                current = current->children[index];
-            }
-            current->isNormalizedWord = true;
-        }
+        trie.insert(word, language);
     }
 
-
     int getMatchScore(const std::string& word) const {
-        // Try exact match
-        TrieNode* current = root;
-        for (char ch : word) {
-            unsigned char index = static_cast<unsigned char>(ch);
-            if (index >= CHAR_SIZE || !current->children[index]) {
-                current = nullptr;
-                break;
-            }
-            current = current->children[index];
-        }
-        if (current && current->isEndOfWord)
-            return 2;
-
-        // Try normalized match
-        std::string normalized = normalizeWord(word);
+        return trie.getMatchScore(word, language);
+    }
 
-        // Do NOT skip if normalized == word (important!)
-        TrieNode* normNode = root;
-        for (char ch : normalized) {
-            unsigned char index = static_cast<unsigned char>(ch);
-            if (index >= CHAR_SIZE || !normNode->children[index]) {
-                normNode = nullptr;
-                break;
-            }
-            normNode = normNode->children[index];
-        }
-        return (normNode && normNode->isNormalizedWord) ? 1 : 0;
+    string getLanguageName() const {
+        return trie.getLanguageName(language);
     }
 
+    // Number of nodes, including the root
+    size_t nodeCount() const {
+        return trie.nodeCount();
+    }
 
-    string getLanguageName() const {
-        return languageName;
+    // Bytes of node storage taken from the arena
+    size_t memoryUsage() const {
+        return trie.memoryUsage();
     }
 };
 
@@ -4,13 +4,20 @@
 #include <wx/msgdlg.h>
 #include <wx/wfstream.h>
 #include <wx/txtstrm.h>
-#include "language_trie.h"
-#include "normalize.h"
+#include <wx/timer.h>
+#include <wx/gauge.h>
+#include <wx/listctrl.h>
+#include "detection_worker.h"
+#include "embedded_dictionary.h"
+#include "file_detector.h"
+#include "language_detector.h"
 #include <sstream>
 #include <iostream>
 #include <map>
+#include <memory>
 #include <vector>
 #include <set>
+#include <thread>
 #include <iomanip>
 #include <fstream>
 #include <functional>
@@ -25,123 +32,190 @@
 
 using namespace std;
 
-// Structure to hold detection results including matrix and contributors
-struct DetectionResult {
-    std::string language;
-    double confidence;
-    std::map<std::string, std::map<std::string, int>> matrix;
-    std::map<std::string, std::map<std::string, std::set<std::string>>> contributors;
+// Control and event IDs
+enum {
+    ID_DETECT = 1001,
+    ID_RUN_TESTS = 1002,
+    ID_DARK_MODE = 1003,
+    ID_DETECTION_DONE = 1004,
+    ID_LIVE_MODE = 1005,
+    ID_INPUT = 1006,
+    ID_LIVE_TIMER = 1007,
+    ID_LOAD_PROGRESS = 1008,
+    ID_LOAD_DONE = 1009,
+    ID_FILE_PROGRESS = 1010,
+    ID_FILE_DONE = 1011,
+    ID_CANCEL_FILE = 1012,
 };
 
-// Function to load words from a file into a LanguageTrie
-void loadWordsFromFile(const string& filename, LanguageTrie* trie) {
-    ifstream file(filename);
-    if (!file.is_open()) {
-        cerr << "Error: Could not open file " << filename << "\n";
-        return;
-    }
+// Quiet time after the last keystroke before live mode re-detects
+const int LIVE_DEBOUNCE_MS = 300;
 
-    string word;
-    while (getline(file, word)) {
-        trie->insert(word);
-    }
+// Opened files larger than this are detected from disk; the editor only
+// shows their beginning
+const size_t PREVIEW_BYTES = 64 * 1024;
 
-    file.close();
-}
+// Steps of the file progress bar
+const int FILE_PROGRESS_RANGE = 1000;
 
-// Function to detect the language of a given input
-DetectionResult detectLanguageWithMatrix(
-    const std::string& input,
-    LanguageTrie* english,
-    LanguageTrie* french,
-    LanguageTrie* german,
-    LanguageTrie* spanish,
-    LanguageTrie* italian
-) {
+// Words each contributor cell lists at first, and how many more every
+// activation of its "more" row adds
+const size_t CONTRIBUTORS_SHOWN = 20;
+const size_t CONTRIBUTORS_STEP = 100;
 
+// A finished detection as the result view needs it: the result without its
+// contributor spans, and each contributing word counted once
+struct DetectionView {
     DetectionResult result;
+    std::vector<WordFrequency> words;   // most frequent first
+};
+
+// Built on the worker thread and carried to the UI thread as the payload of
+// a wxThreadEvent; `view` is null when detection was cancelled
+struct DetectionOutput {
+    uint64_t request = 0;
+    std::shared_ptr<const DetectionView> view;
+};
 
-    // Check for empty or non-alphabetic input
-    bool hasAlphabetic = false;
-    for (size_t i = 0; i < input.size(); ) {
-        // Check for UTF-8 sequences
-        unsigned char c = static_cast<unsigned char>(input[i]);
-        if ((c >= 0xC0 && c <= 0xF7) || isalpha(c)) {
-            hasAlphabetic = true;
-            break;
+static std::shared_ptr<const DetectionView> MakeView(const DetectionResult& result, const std::string& input) {
+    std::shared_ptr<DetectionView> view = std::make_shared<DetectionView>();
+    view->words = result.wordFrequencies(input);
+    view->result = result;
+    view->result.contributorSpans = std::vector<TokenSpan>();
+    return view;
+}
+
+// The word match matrix. Virtual, so wx only asks for the cells on screen.
+class MatrixList : public wxListCtrl {
+public:
+    MatrixList(wxWindow* parent)
+        : wxListCtrl(parent, wxID_ANY, wxDefaultPosition, wxSize(400, 150),
+                     wxLC_REPORT | wxLC_VIRTUAL | wxLC_HRULES | wxLC_VRULES) {}
+
+    void ShowView(const std::shared_ptr<const DetectionView>& shown) {
+        view = shown;
+        const std::vector<std::string>& langs = view->result.languages;
+        if (static_cast<size_t>(GetColumnCount()) != langs.size() + 1) {
+            DeleteAllColumns();
+            InsertColumn(0, "");
+            for (size_t i = 0; i < langs.size(); ++i) {
+                InsertColumn(static_cast<long>(i + 1), wxString::FromUTF8(langs[i]), wxLIST_FORMAT_RIGHT);
+            }
         }
-        i++;
+        SetItemCount(static_cast<long>(langs.size()));
+        Refresh();
     }
 
-    if (!hasAlphabetic) {
-        result.language = "Unknown";
-        result.confidence = 0.0;
-        return result;
+protected:
+    wxString OnGetItemText(long item, long column) const override {
+        if (!view) return "";
+        if (column == 0) return wxString::FromUTF8(view->result.languages[item]);
+        return wxString::Format("%g", view->result.at(static_cast<size_t>(item), static_cast<size_t>(column - 1)));
     }
 
-    // Process words and build matrix
-    std::istringstream stream(input);
-    std::string word;
-    std::vector<std::string> langs = {"English", "French", "German", "Spanish", "Italian"};
-
-    while (stream >> word) {
-        std::set<std::string> detected;
-        std::string normalized = normalizeWord(word);
-
-        int en = english->getMatchScore(normalized);
-        int fr = french->getMatchScore(normalized);
-        int de = german->getMatchScore(normalized);
-        int sp = spanish->getMatchScore(normalized);
-        int it = italian->getMatchScore(normalized);
-
-        if (en) detected.insert("English");
-        if (fr) detected.insert("French");
-        if (de) detected.insert("German");
-        if (sp) detected.insert("Spanish");
-        if (it) detected.insert("Italian");
-
-        if (!detected.empty()) {
-            for (const auto& lang : detected) {
-                result.matrix[lang][lang] += 1;
-                result.contributors[lang][lang].insert(word);
-            }
+private:
+    std::shared_ptr<const DetectionView> view;
+};
 
-            for (const auto& l1 : detected) {
-                for (const auto& l2 : detected) {
-                    if (l1 != l2) {
-                        result.matrix[l1][l2] += 0.5;
-                        result.contributors[l1][l2].insert(word);
-                    }
+// The words behind each matrix cell, most frequent first. A cell lists its
+// top CONTRIBUTORS_SHOWN words and a row counting the rest, which lists more
+// when activated, so no input size makes the list expensive to fill.
+class ContributorList : public wxListCtrl {
+public:
+    ContributorList(wxWindow* parent)
+        : wxListCtrl(parent, wxID_ANY, wxDefaultPosition, wxSize(400, 200),
+                     wxLC_REPORT | wxLC_VIRTUAL | wxLC_SINGLE_SEL) {
+        InsertColumn(0, "Languages", wxLIST_FORMAT_LEFT, 180);
+        InsertColumn(1, "Word", wxLIST_FORMAT_LEFT, 220);
+        InsertColumn(2, "Count", wxLIST_FORMAT_RIGHT, 80);
+        Bind(wxEVT_LIST_ITEM_ACTIVATED, &ContributorList::OnActivated, this);
+    }
+
+    void ShowView(const std::shared_ptr<const DetectionView>& shown) {
+        view = shown;
+        cells.clear();
+
+        // Words go to every cell of a pair of their languages; the matrix
+        // is symmetric, so only cells on and above the diagonal are listed
+        size_t count = view->result.languages.size();
+        std::vector<Cell> byCell(count * count);
+        for (uint32_t i = 0; i < view->words.size(); ++i) {
+            LanguageMask languages = view->words[i].languages;
+            for (LanguageMask rowBits = languages; rowBits; rowBits &= rowBits - 1) {
+                size_t row = static_cast<size_t>(__builtin_ctzll(rowBits));
+                for (LanguageMask colBits = rowBits; colBits; colBits &= colBits - 1) {
+                    size_t col = static_cast<size_t>(__builtin_ctzll(colBits));
+                    if (row < count && col < count) byCell[row * count + col].words.push_back(i);
                 }
             }
         }
+        for (size_t i = 0; i < byCell.size(); ++i) {
+            if (byCell[i].words.empty()) continue;
+            Cell& cell = byCell[i];
+            cell.row = i / count;
+            cell.col = i % count;
+            cell.shown = std::min(CONTRIBUTORS_SHOWN, cell.words.size());
+            cells.push_back(std::move(cell));
+        }
+        RebuildRows();
     }
 
-    // Find best language
-    std::string bestLang;
-    int maxDiagonal = -1;
-
-    for (const std::string& lang : langs) {
-        if (result.matrix[lang][lang] > maxDiagonal) {
-            maxDiagonal = result.matrix[lang][lang];
-            bestLang = lang;
+protected:
+    wxString OnGetItemText(long item, long column) const override {
+        const Row& row = rows[item];
+        const Cell& cell = cells[row.cell];
+        if (column == 0) {
+            if (row.word != 0) return "";
+            const std::vector<std::string>& langs = view->result.languages;
+            return cell.row == cell.col ? wxString::FromUTF8(langs[cell.row])
+                                        : wxString::FromUTF8(langs[cell.row] + " / " + langs[cell.col]);
+        }
+        if (row.word == MORE) {
+            return column == 1 ? wxString::Format("... %zu more (double-click to list)", cell.words.size() - cell.shown)
+                               : wxString();
         }
+        const WordFrequency& word = view->words[cell.words[row.word]];
+        return column == 1 ? wxString::FromUTF8(word.word) : wxString::Format("%zu", word.count);
     }
 
-    // Calculate total for confidence
-    int total = 0;
-    for (const std::string& row : langs) {
-        for (const std::string& col : langs) {
-            if (row == col || row < col) total += result.matrix[row][col];
+private:
+    static const uint32_t MORE = UINT32_MAX;
+
+    struct Cell {
+        size_t row = 0;
+        size_t col = 0;
+        std::vector<uint32_t> words;   // indices into view->words
+        size_t shown = 0;
+    };
+
+    // A line of the list: a word of a cell, or the cell's "more" line
+    struct Row {
+        uint32_t cell;
+        uint32_t word;
+    };
+
+    void RebuildRows() {
+        rows.clear();
+        for (uint32_t c = 0; c < cells.size(); ++c) {
+            for (uint32_t w = 0; w < cells[c].shown; ++w) rows.push_back({c, w});
+            if (cells[c].shown < cells[c].words.size()) rows.push_back({c, MORE});
         }
+        SetItemCount(static_cast<long>(rows.size()));
+        Refresh();
     }
 
-    result.language = bestLang;
-    result.confidence = (total > 0) ? static_cast<double>(result.matrix[bestLang][bestLang]) / total : 0.0;
-
+    void OnActivated(wxListEvent& event) {
+        const Row& row = rows[event.GetIndex()];
+        if (row.word != MORE) return;
+        Cell& cell = cells[row.cell];
+        cell.shown = std::min(cell.shown + CONTRIBUTORS_STEP, cell.words.size());
+        RebuildRows();
+    }
 
-    return result;
-}
+    std::shared_ptr<const DetectionView> view;
+    std::vector<Cell> cells;
+    std::vector<Row> rows;
+};
 
 // Main Application Class
 class LangWitchApp : public wxApp {
@@ -167,19 +241,54 @@ private:
 
     // Controls for main tab
     wxTextCtrl* inputField;
-    wxTextCtrl* outputField;
+    wxStaticText* verdictLabel;
+    MatrixList* matrixList;
+    ContributorList* contributorList;
+    std::shared_ptr<const DetectionView> shownView;   // what the result view shows, for saving
 
     // Controls for test tab
     wxTextCtrl* testOutputField;
 
     // Existing members
-    LanguageTrie* english;
-    LanguageTrie* french;
-    LanguageTrie* german;
-    LanguageTrie* spanish;
-    LanguageTrie* italian;
+    DictionaryImage* dictionary;
+    NgramProfile* ngrams;
+    DetectionOptions detectionOptions;
+
+    // Detection runs off the UI thread; only the newest request is shown
+    std::unique_ptr<DetectionWorker> worker;
+    uint64_t latestRequest;
+    wxTimer liveTimer;
+    bool liveMode;
+
+    // Dictionaries load in the background while the window is already up;
+    // a detection asked for meanwhile runs once they are ready
+    std::thread loaderThread;
+    bool detectWhenReady;
+
+    // A large opened file is mapped and detected on its own thread, with a
+    // progress bar and a Cancel button; editing the preview forgets the file
+    std::string openedFile;
+    std::thread fileThread;
+    std::shared_ptr<std::atomic<bool>> fileCancel;
+    uint64_t fileRequest;
+    wxGauge* fileGauge;
+    wxButton* cancelFileButton;
 
     void OnDetectLanguage(wxCommandEvent& event);
+    void OnDetectionDone(wxThreadEvent& event);
+    void OnToggleLiveMode(wxCommandEvent& event);
+    void OnInputChanged(wxCommandEvent& event);
+    void OnLiveTimer(wxTimerEvent& event);
+    void StartDetection();
+    void ShowView(const std::shared_ptr<const DetectionView>& view);
+    void StartFileDetection();
+    void StopFileDetection();
+    void ShowFileProgress(bool show);
+    void OnFileProgress(wxThreadEvent& event);
+    void OnFileDetected(wxThreadEvent& event);
+    void OnCancelFile(wxCommandEvent& event);
+    void OnLoadProgress(wxThreadEvent& event);
+    void OnDictionaryLoaded(wxThreadEvent& event);
     void OnExit(wxCommandEvent& event);
     void OnAbout(wxCommandEvent& event);
     void OnToggleDarkMode(wxCommandEvent& event);
@@ -194,16 +303,73 @@ private:
 wxBEGIN_EVENT_TABLE(LangWitchFrame, wxFrame)
     EVT_MENU(wxID_EXIT, LangWitchFrame::OnExit)
     EVT_MENU(wxID_ABOUT, LangWitchFrame::OnAbout)
-    EVT_BUTTON(1001, LangWitchFrame::OnDetectLanguage)
-    EVT_MENU(1003, LangWitchFrame::OnToggleDarkMode)
+    EVT_BUTTON(ID_DETECT, LangWitchFrame::OnDetectLanguage)
+    EVT_MENU(ID_DARK_MODE, LangWitchFrame::OnToggleDarkMode)
+    EVT_MENU(ID_LIVE_MODE, LangWitchFrame::OnToggleLiveMode)
     EVT_MENU(wxID_OPEN, LangWitchFrame::OnOpen)
     EVT_MENU(wxID_SAVE, LangWitchFrame::OnSave)
-    EVT_BUTTON(1002, LangWitchFrame::OnRunTests) // Add button handler for test tab
+    EVT_BUTTON(ID_RUN_TESTS, LangWitchFrame::OnRunTests) // Add button handler for test tab
+    EVT_TEXT(ID_INPUT, LangWitchFrame::OnInputChanged)
+    EVT_TIMER(ID_LIVE_TIMER, LangWitchFrame::OnLiveTimer)
+    EVT_THREAD(ID_DETECTION_DONE, LangWitchFrame::OnDetectionDone)
+    EVT_THREAD(ID_LOAD_PROGRESS, LangWitchFrame::OnLoadProgress)
+    EVT_THREAD(ID_LOAD_DONE, LangWitchFrame::OnDictionaryLoaded)
+    EVT_THREAD(ID_FILE_PROGRESS, LangWitchFrame::OnFileProgress)
+    EVT_THREAD(ID_FILE_DONE, LangWitchFrame::OnFileDetected)
+    EVT_BUTTON(ID_CANCEL_FILE, LangWitchFrame::OnCancelFile)
 wxEND_EVENT_TABLE()
 
 
 wxIMPLEMENT_APP(LangWitchApp);
 
+// Renders the verdict, matrix and the top contributors of each cell as text,
+// for saving
+static std::string FormatResult(const DetectionView& view) {
+    const DetectionResult& result = view.result;
+    std::ostringstream output;
+    const std::vector<std::string>& langs = result.languages;
+
+    // Format the basic detection result
+    output << "Language: " << result.language << "\n";
+    output << "Confidence: " << std::fixed << std::setprecision(2) << result.confidence * 100 << "%\n\n";
+
+    // Add the matrix display
+    output << "--- Language Word Match Square Matrix ---\n";
+    output << std::setw(10) << "";
+    for (const auto& col : langs) {
+        output << std::setw(10) << col;
+    }
+    output << "\n";
+
+    for (size_t row = 0; row < langs.size(); ++row) {
+        output << std::setw(10) << langs[row];
+        for (size_t col = 0; col < langs.size(); ++col) {
+            output << std::setw(10) << result.at(row, col);
+        }
+        output << "\n";
+    }
+
+    // Add word contributors information, most frequent first
+    output << "\n--- Word Contributors per Matrix Cell ---\n";
+    for (size_t row = 0; row < langs.size(); ++row) {
+        for (size_t col = row; col < langs.size(); ++col) {
+            LanguageMask wanted = (LanguageMask(1) << row) | (LanguageMask(1) << col);
+            size_t listed = 0, total = 0;
+            for (const WordFrequency& word : view.words) {
+                if ((word.languages & wanted) != wanted) continue;
+                if (total++ == 0) output << langs[row] << " " << langs[col] << " : ";
+                if (listed < CONTRIBUTORS_SHOWN) {
+                    output << word.word << " (" << word.count << ") ";
+                    ++listed;
+                }
+            }
+            if (total > listed) output << "... and " << total - listed << " more";
+            if (total) output << "\n";
+        }
+    }
+    return output.str();
+}
+
 bool LangWitchApp::OnInit() {
     LangWitchFrame* frame = new LangWitchFrame("LangWitch Language Detector");
     frame->Show(true);
@@ -212,7 +378,8 @@ bool LangWitchApp::OnInit() {
 
 LangWitchFrame::LangWitchFrame(const wxString& title)
     : wxFrame(nullptr, wxID_ANY, title, wxDefaultPosition, wxSize(600, 500)),
-      english(nullptr), french(nullptr), german(nullptr), spanish(nullptr), italian(nullptr) {
+      dictionary(nullptr), ngrams(nullptr), latestRequest(0), liveTimer(this, ID_LIVE_TIMER), liveMode(false),
+      detectWhenReady(false), fileRequest(0) {
 
     // Menu Bar (keep existing menu code unchanged)
     wxMenu* fileMenu = new wxMenu;
@@ -231,7 +398,8 @@ LangWitchFrame::LangWitchFrame(const wxString& title)
 
     // Preferences menu
     wxMenu* prefsMenu = new wxMenu;
-    prefsMenu->AppendCheckItem(1003, "Dark Mode", "Toggle dark mode");
+    prefsMenu->AppendCheckItem(ID_DARK_MODE, "Dark Mode", "Toggle dark mode");
+    prefsMenu->AppendCheckItem(ID_LIVE_MODE, "&Live Detection\tCtrl+L", "Re-detect while typing");
     menuBar->Append(prefsMenu, "&Preferences");
 
     // Create the notebook control - this will hold both tabs
@@ -244,22 +412,32 @@ LangWitchFrame::LangWitchFrame(const wxString& title)
     wxStaticText* inputLabel = new wxStaticText(mainPanel, wxID_ANY, "Enter Text:");
     mainVbox->Add(inputLabel, 0, wxALL, 10);
 
-    inputField = new wxTextCtrl(mainPanel, wxID_ANY, "", wxDefaultPosition, wxSize(400, 30));
-    mainVbox->Add(inputField, 0, wxALL | wxEXPAND, 10);
+    inputField = new wxTextCtrl(mainPanel, ID_INPUT, "", wxDefaultPosition, wxSize(400, 120), wxTE_MULTILINE);
+    mainVbox->Add(inputField, 1, wxALL | wxEXPAND, 10);
 
-    wxButton* detectButton = new wxButton(mainPanel, 1001, "Detect Language");
+    wxButton* detectButton = new wxButton(mainPanel, ID_DETECT, "Detect Language");
     mainVbox->Add(detectButton, 0, wxALL | wxALIGN_CENTER, 10);
 
-    wxStaticText* outputLabel = new wxStaticText(mainPanel, wxID_ANY, "Detected Language:");
-    mainVbox->Add(outputLabel, 0, wxALL, 10);
-
-    outputField = new wxTextCtrl(mainPanel, wxID_ANY, "", wxDefaultPosition, wxSize(400, 300),
-                                 wxTE_MULTILINE | wxTE_READONLY);
-    mainVbox->Add(outputField, 1, wxALL | wxEXPAND, 10);
+    // Progress of a file detected from disk, hidden when none is running
+    wxBoxSizer* fileProgressBox = new wxBoxSizer(wxHORIZONTAL);
+    fileGauge = new wxGauge(mainPanel, wxID_ANY, FILE_PROGRESS_RANGE);
+    fileProgressBox->Add(fileGauge, 1, wxALIGN_CENTER_VERTICAL | wxRIGHT, 10);
+    cancelFileButton = new wxButton(mainPanel, ID_CANCEL_FILE, "Cancel");
+    fileProgressBox->Add(cancelFileButton, 0, wxALIGN_CENTER_VERTICAL);
+    mainVbox->Add(fileProgressBox, 0, wxLEFT | wxRIGHT | wxEXPAND, 10);
+    fileGauge->Hide();
+    cancelFileButton->Hide();
+
+    verdictLabel = new wxStaticText(mainPanel, wxID_ANY, "Detected Language:");
+    mainVbox->Add(verdictLabel, 0, wxALL, 10);
+
+    // Virtual lists: only the rows on screen are ever rendered
+    matrixList = new MatrixList(mainPanel);
+    mainVbox->Add(matrixList, 1, wxLEFT | wxRIGHT | wxEXPAND, 10);
+    contributorList = new ContributorList(mainPanel);
+    mainVbox->Add(contributorList, 2, wxALL | wxEXPAND, 10);
 
-    // Set monospaced font for better matrix display
     wxFont monoFont(10, wxFONTFAMILY_TELETYPE, wxFONTSTYLE_NORMAL, wxFONTWEIGHT_NORMAL);
-    outputField->SetFont(monoFont);
 
     mainPanel->SetSizer(mainVbox);
 
@@ -270,7 +448,7 @@ LangWitchFrame::LangWitchFrame(const wxString& title)
     wxStaticText* testLabel = new wxStaticText(testPanel, wxID_ANY, "Test Cases:");
     testVbox->Add(testLabel, 0, wxALL, 10);
 
-    wxButton* runTestsButton = new wxButton(testPanel, 1002, "Run Test Cases");
+    wxButton* runTestsButton = new wxButton(testPanel, ID_RUN_TESTS, "Run Test Cases");
     testVbox->Add(runTestsButton, 0, wxALL | wxALIGN_CENTER, 10);
 
     testOutputField = new wxTextCtrl(testPanel, wxID_ANY, "", wxDefaultPosition, wxSize(400, 350),
@@ -295,80 +473,218 @@ LangWitchFrame::LangWitchFrame(const wxString& title)
     LoadLanguageTries();
 
     wxAcceleratorEntry entries[2];
-    entries[0].Set(wxACCEL_CTRL, (int)'D', 1001); // Dtection
-    entries[1].Set(wxACCEL_CTRL, (int)'M', 1003); // Dark Mode
+    entries[0].Set(wxACCEL_CTRL, (int)'D', ID_DETECT); // Dtection
+    entries[1].Set(wxACCEL_CTRL, (int)'M', ID_DARK_MODE); // Dark Mode
     wxAcceleratorTable accel(2, entries);
     SetAcceleratorTable(accel);
 
     CreateStatusBar();
-    SetStatusText("Ready");
+    SetStatusText("Loading dictionaries...");
 }
 
 
+// Starts loading the dictionaries on a background thread. The dictionary
+// built into the executable is attached without reading anything; word
+// lists named by $LANGWITCH_DATA_DIR or a manifest next to the executable
+// are read in parallel instead, with progress reported through thread events.
 void LangWitchFrame::LoadLanguageTries() {
 
-    english = new LanguageTrie("English");
-    french = new LanguageTrie("French");
-    german = new LanguageTrie("German");
-    spanish = new LanguageTrie("Spanish");
-    italian = new LanguageTrie("Italian");
-
-    loadWordsFromFile("/home/mnm/auc/uni/sem/spring25/CSCE2211/project/LangWitch/english.txt", english);
-    loadWordsFromFile("/home/mnm/auc/uni/sem/spring25/CSCE2211/project/LangWitch/french.txt", french);
-    loadWordsFromFile("/home/mnm/auc/uni/sem/spring25/CSCE2211/project/LangWitch/german.txt", german);
-    loadWordsFromFile("/home/mnm/auc/uni/sem/spring25/CSCE2211/project/LangWitch/spanish.txt", spanish);
-    loadWordsFromFile("/home/mnm/auc/uni/sem/spring25/CSCE2211/project/LangWitch/italian.txt", italian);
+    const std::string executablePath = wxStandardPaths::Get().GetExecutablePath().utf8_string();
+
+    dictionary = new DictionaryImage();
+    ngrams = new NgramProfile();
+
+    loaderThread = std::thread([this, executablePath] {
+        std::string dataDir;
+        bool ok = loadDefaultDictionary(dictionary, executablePath, &dataDir, nullptr,
+            [this](const std::string& language, size_t loaded, size_t total) {
+                wxThreadEvent* event = new wxThreadEvent(wxEVT_THREAD, ID_LOAD_PROGRESS);
+                event->SetString(wxString::Format("Loading dictionaries... %s (%zu/%zu)",
+                                                  wxString::FromUTF8(language), loaded, total));
+                wxQueueEvent(this, event);
+            });
+        ngrams->build(*dictionary);
+
+        wxThreadEvent* event = new wxThreadEvent(wxEVT_THREAD, ID_LOAD_DONE);
+        event->SetInt(ok ? 1 : 0);
+        event->SetString(dataDir.empty() ? wxString("the built-in dictionary") : wxString::FromUTF8(dataDir));
+        wxQueueEvent(this, event);
+    });
+}
+
+void LangWitchFrame::OnLoadProgress(wxThreadEvent& event) {
+    SetStatusText(event.GetString());
+}
+
+void LangWitchFrame::OnDictionaryLoaded(wxThreadEvent& event) {
+    loaderThread.join();
+    if (!event.GetInt()) {
+        wxMessageBox("Could not load the dictionaries from " + event.GetString() +
+                     ".\nSet LANGWITCH_DATA_DIR to the folder holding languages.manifest.",
+                     "LangWitch", wxOK | wxICON_WARNING, this);
+    }
+    detectionOptions.ngrams = ngrams;
+
+    // Words are counted on the worker thread, so the UI thread only hands
+    // the view to the lists
+    worker.reset(new DetectionWorker(*dictionary, detectionOptions,
+        [this](uint64_t request, const std::string& text, const DetectionResult& result) {
+            DetectionOutput output;
+            output.request = request;
+            output.view = MakeView(result, text);
+            wxThreadEvent* event = new wxThreadEvent(wxEVT_THREAD, ID_DETECTION_DONE);
+            event->SetPayload(output);
+            wxQueueEvent(this, event);
+        }));
+
+    SetStatusText("Ready");
+    if (detectWhenReady) {
+        detectWhenReady = false;
+        StartDetection();
+    }
 }
 
 void LangWitchFrame::OnDetectLanguage(wxCommandEvent& event) {
-    SetStatusText("Detecting language...");
+    liveTimer.Stop();
+    StartDetection();
+}
 
-    const std::string input = inputField->GetValue().utf8_string();   // explicit UTF-8
+void LangWitchFrame::StartDetection() {
+    if (!worker) {
+        detectWhenReady = true;
+        SetStatusText("Detecting as soon as the dictionaries are loaded...");
+        return;
+    }
+    if (!openedFile.empty()) {
+        StartFileDetection();
+        return;
+    }
+    SetStatusText("Detecting language...");
+    latestRequest = worker->submit(inputField->GetValue().utf8_string());   // explicit UTF-8
+}
 
-    // Use the new function that returns more detailed results
-    DetectionResult result = detectLanguageWithMatrix(input, english, french, german, spanish, italian);
+void LangWitchFrame::OnDetectionDone(wxThreadEvent& event) {
+    DetectionOutput output = event.GetPayload<DetectionOutput>();
+    if (output.request != latestRequest) return;   // superseded while queued
 
-    std::ostringstream output;
-    std::vector<std::string> langs = {"English", "French", "German", "Spanish", "Italian"};
+    ShowView(output.view);
+    SetStatusText("Detection complete");
+}
 
-    // Format the basic detection result
-    output << "Language: " << result.language << "\n";
-    output << "Confidence: " << std::fixed << std::setprecision(2) << result.confidence * 100 << "%\n\n";
+void LangWitchFrame::ShowView(const std::shared_ptr<const DetectionView>& view) {
+    shownView = view;
+    verdictLabel->SetLabel(wxString::Format("Detected Language: %s (confidence %.2f%%)",
+                                            wxString::FromUTF8(view->result.language),
+                                            view->result.confidence * 100));
+    matrixList->ShowView(view);
+    contributorList->ShowView(view);
+}
 
-    // Add the matrix display
-    output << "--- Language Word Match Square Matrix ---\n";
-    output << std::setw(10) << "";
-    for (const auto& col : langs) {
-        output << std::setw(10) << col;
+void LangWitchFrame::OnToggleLiveMode(wxCommandEvent& event) {
+    liveMode = event.IsChecked();
+    if (liveMode) {
+        StartDetection();
+    } else {
+        liveTimer.Stop();
     }
-    output << "\n";
+}
 
-    for (const auto& row : langs) {
-        output << std::setw(10) << row;
-        for (const auto& col : langs) {
-            output << std::setw(10) << result.matrix[row][col];
-        }
-        output << "\n";
+// Every keystroke restarts the timer, so a burst of typing detects once.
+// Once the preview of a file is edited, the editor text is what counts.
+void LangWitchFrame::OnInputChanged(wxCommandEvent& event) {
+    if (!openedFile.empty()) {
+        openedFile.clear();
+        StopFileDetection();
+        ShowFileProgress(false);
     }
+    if (liveMode) liveTimer.StartOnce(LIVE_DEBOUNCE_MS);
+}
 
-    // Add word contributors information
-    output << "\n--- Word Contributors per Matrix Cell ---\n";
-    for (const auto& row : langs) {
-        for (const auto& col : langs) {
-            if (!result.contributors[row][col].empty()) {
-                output << row << " " << col << " : ";
-                for (const auto& w : result.contributors[row][col]) {
-                    output << w << " ";
-                }
-                output << "\n";
-            }
-        }
+// Detects the opened file from disk, replacing any file detection running
+void LangWitchFrame::StartFileDetection() {
+    StopFileDetection();
+    worker->cancel();
+    latestRequest = 0;   // no text result may replace the file's
+
+    uint64_t request = ++fileRequest;
+    std::shared_ptr<std::atomic<bool>> cancelled = std::make_shared<std::atomic<bool>>(false);
+    fileCancel = cancelled;
+    DetectionOptions options = detectionOptions;
+    options.cancel = cancelled.get();
+
+    fileGauge->SetValue(0);
+    ShowFileProgress(true);
+    SetStatusText("Detecting " + wxFileName(wxString::FromUTF8(openedFile)).GetFullName() + "...");
+
+    // `cancelled` travels with the thread so options.cancel outlives it
+    fileThread = std::thread([this, path = openedFile, options, request, cancelled] {
+        int shown = -1;
+        DetectionResult result;
+        bool ok = detectFile(path, *dictionary, options, &result, [&](size_t done, size_t total) {
+            int step = static_cast<int>(done * FILE_PROGRESS_RANGE / total);
+            if (step == shown) return;
+            shown = step;
+            wxThreadEvent* event = new wxThreadEvent(wxEVT_THREAD, ID_FILE_PROGRESS);
+            event->SetInt(step);
+            event->SetExtraLong(static_cast<long>(request));
+            wxQueueEvent(this, event);
+        });
+
+        DetectionOutput output;
+        output.request = request;
+        if (ok && !result.cancelled) output.view = MakeView(result, std::string());
+        wxThreadEvent* event = new wxThreadEvent(wxEVT_THREAD, ID_FILE_DONE);
+        event->SetInt(ok ? 1 : 0);
+        event->SetString(wxString::FromUTF8(path));
+        event->SetPayload(output);
+        wxQueueEvent(this, event);
+    });
+}
+
+// Cancels and joins the file thread; its pending events become stale
+void LangWitchFrame::StopFileDetection() {
+    if (!fileThread.joinable()) return;
+    fileCancel->store(true, std::memory_order_relaxed);
+    fileThread.join();
+    fileCancel.reset();
+    ++fileRequest;
+}
+
+void LangWitchFrame::ShowFileProgress(bool show) {
+    fileGauge->Show(show);
+    cancelFileButton->Show(show);
+    mainPanel->Layout();
+}
+
+void LangWitchFrame::OnFileProgress(wxThreadEvent& event) {
+    if (static_cast<uint64_t>(event.GetExtraLong()) != fileRequest) return;
+    fileGauge->SetValue(event.GetInt());
+}
+
+void LangWitchFrame::OnFileDetected(wxThreadEvent& event) {
+    DetectionOutput output = event.GetPayload<DetectionOutput>();
+    if (output.request != fileRequest) return;   // cancelled and replaced
+
+    fileThread.join();
+    fileCancel.reset();
+    ShowFileProgress(false);
+    if (!event.GetInt()) {
+        wxLogError("Cannot read file '%s'.", event.GetString());
+        SetStatusText("Detection failed");
+    } else if (!output.view) {
+        SetStatusText("Detection cancelled");
+    } else {
+        ShowView(output.view);
+        SetStatusText("Detection complete (words are not listed for files)");
     }
+}
 
-    const wxString wxOutput = wxString::FromUTF8(output.str());
-    outputField->SetValue(wxOutput);
+void LangWitchFrame::OnCancelFile(wxCommandEvent& event) {
+    if (fileCancel) fileCancel->store(true, std::memory_order_relaxed);
+}
 
-    SetStatusText("Detection complete");
+void LangWitchFrame::OnLiveTimer(wxTimerEvent& event) {
+    StartDetection();
 }
 
 void LangWitchFrame::OnExit(wxCommandEvent& event) {
@@ -408,6 +724,10 @@ void LangWitchFrame::OnToggleDarkMode(wxCommandEvent& event) {
         else if (wxStaticText* label = dynamic_cast<wxStaticText*>(control)) {
             label->SetForegroundColour(textColor);
         }
+        else if (wxListCtrl* list = dynamic_cast<wxListCtrl*>(control)) {
+            list->SetBackgroundColour(controlBgColor);
+            list->SetForegroundColour(textColor);
+        }
     }
 
     // Update test panel controls
@@ -449,6 +769,10 @@ void LangWitchFrame::OnToggleDarkMode(wxCommandEvent& event) {
 
 
 void LangWitchFrame::OnRunTests(wxCommandEvent& event) {
+    if (!worker) {
+        SetStatusText("Dictionaries are still loading");
+        return;
+    }
     SetStatusText("Running test cases...");
 
     // Clear test output
@@ -485,15 +809,19 @@ void LangWitchFrame::OnRunTests(wxCommandEvent& event) {
         // 12. Out-of-vocabulary words
         {"flerbin schmaggle", "Unknown"}, // nonsense / OOV
         // 13. Tie situation
-        {"world monde welt", "English"}, // 1 word per language, expect tie handling
+        // "world" is in every list, so French and German tie with two
+        // words each; ties go to the language listed first in the manifest
+        {"world monde welt", "French"},
         // 14. Minor typos (up to 2 modifications)
         {"helo wrld", "English"}, // typo for "hello world"
         {"bonjor le mnde", "French"}, // typo for "bonjour le monde"
         {"hallo weltz", "German"}, // extra char
         {"holaa mundo", "Spanish"}, // double 'a'
-        {"cia mond", "Italian"}, // missing 'o'
+        {"cia mond", "Italian"}, // missing 'o'; misses with the shipped lists, where "mond" is German
+                                 // and "cia" is in most lists, so neither is taken as a typo
         // 15. Typo in accented word
-        {"tres contnet", "French"}, // typo in "très content"
+        {"tres contnet", "French"}, // typo in "très content"; misses with the shipped lists, where
+                                    // "tres" is only Spanish (French has no "très")
         // 16. Garbage with 1 correct word
         {"flargle hallo blurt", "German"},
     };
@@ -506,7 +834,7 @@ void LangWitchFrame::OnRunTests(wxCommandEvent& event) {
         const std::string& expected = testCase.second;
 
         // Use the detectLanguageWithMatrix function to get detailed results
-        DetectionResult result = detectLanguageWithMatrix(input, english, french, german, spanish, italian);
+        DetectionResult result = detectLanguageWithMatrix(input, *dictionary, detectionOptions);
 
         output << "Input: \"" << input << "\"\n"
                << "Expected: " << expected << "\n"
@@ -515,7 +843,7 @@ void LangWitchFrame::OnRunTests(wxCommandEvent& event) {
                << result.confidence * 100 << "%\n\n";
 
         // Add matrix for this test case
-        std::vector<std::string> langs = {"English", "French", "German", "Spanish", "Italian"};
+        const std::vector<std::string>& langs = result.languages;
 
         output << "--- Language Matrix ---\n";
         output << std::setw(10) << "";
@@ -524,10 +852,10 @@ void LangWitchFrame::OnRunTests(wxCommandEvent& event) {
         }
         output << "\n";
 
-        for (const auto& row : langs) {
-            output << std::setw(10) << row;
-            for (const auto& col : langs) {
-                output << std::setw(10) << result.matrix[row][col];
+        for (size_t row = 0; row < langs.size(); ++row) {
+            output << std::setw(10) << langs[row];
+            for (size_t col = 0; col < langs.size(); ++col) {
+                output << std::setw(10) << result.at(row, col);
             }
             output << "\n";
         }
@@ -551,24 +879,31 @@ void LangWitchFrame::OnOpen(wxCommandEvent& event) {
     if (openDialog.ShowModal() == wxID_CANCEL)
         return;
 
-    wxFileInputStream input(openDialog.GetPath());
-    if (!input.IsOk()) {
+    // Only the beginning is read here; a longer file is never loaded whole
+    std::string path = openDialog.GetPath().utf8_string();
+    std::string preview;
+    bool truncated = false;
+    if (!readFilePreview(path, PREVIEW_BYTES, &preview, &truncated)) {
         wxLogError("Cannot open file '%s'.", openDialog.GetPath());
         return;
     }
+    StopFileDetection();
+    ShowFileProgress(false);
 
-    wxTextInputStream text(input);
-    wxString line;
-    wxString content;
+    wxString content = wxString::FromUTF8(preview);
+    if (content.empty() && !preview.empty()) content = wxString(preview.data(), wxConvISO8859_1, preview.size());
 
-    while (!input.Eof()) {
-        line = text.ReadLine();
-        content.Append(line);
-        content.Append("\n");
+    if (!truncated) {
+        openedFile.clear();
+        inputField->SetValue(content);
+        SetStatusText("File loaded.");
+        return;
     }
 
-    inputField->SetValue(content);
-    SetStatusText("File loaded.");
+    // ChangeValue, unlike SetValue, does not count as an edit of the preview
+    openedFile = path;
+    inputField->ChangeValue(content);
+    StartDetection();
 }
 
 // Implementation
@@ -596,15 +931,16 @@ void LangWitchFrame::OnSave(wxCommandEvent& event) {
     text.WriteString("\n\n=== LANGUAGE DETECTION RESULT ===\n");
 
     // Save the detection result
-    text.WriteString(outputField->GetValue());
+    if (shownView) text.WriteString(wxString::FromUTF8(FormatResult(*shownView)));
 
     SetStatusText("Input text and detection result saved.");
 }
 
 LangWitchFrame::~LangWitchFrame() {
-    delete english;
-    delete french;
-    delete german;
-    delete spanish;
-    delete italian;
+    liveTimer.Stop();
+    StopFileDetection();
+    worker.reset();   // joins the thread, which reads the dictionary
+    if (loaderThread.joinable()) loaderThread.join();
+    delete ngrams;
+    delete dictionary;
 }
\ No newline at end of file
@@ -0,0 +1,238 @@
+#ifndef MULTI_LANGUAGE_TRIE_H
+#define MULTI_LANGUAGE_TRIE_H
+
+#include <algorithm>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "trie_node.h"
+#include "normalize.h"
+
+using namespace std;
+
+// Result of a single walk: which languages have the key as a word, and which
+// have it as the normalized form of a word
+struct LanguageMatch {
+    LanguageMask exact = 0;
+    LanguageMask normalized = 0;
+
+    LanguageMask any() const { return exact | normalized; }
+};
+
+// A key to insert for one language, and whether a word, a normalized word
+// or both end there
+struct TrieEntry {
+    std::string key;
+    bool exact = false;
+    bool normalized = false;
+};
+
+// One trie shared by every language. Each node records, per language, whether
+// a word (or a normalized word) ends there, so a single traversal answers the
+// lookup for all languages at once. Nodes live in a TrieArena, so dropping
+// the trie frees a few large blocks instead of walking every node.
+class MultiLanguageTrie {
+private:
+    TrieArena arena;
+    TrieNodeRef root;
+    vector<string> languageNames;
+
+public:
+    // Constructor
+    MultiLanguageTrie() {
+        root = arena.create();
+    }
+
+    MultiLanguageTrie(const MultiLanguageTrie&) = delete;
+    MultiLanguageTrie& operator=(const MultiLanguageTrie&) = delete;
+
+    // Registers a language and returns its index, or -1 if MAX_LANGUAGES
+    // languages are already registered
+    int addLanguage(const string& name) {
+        if (languageNames.size() >= MAX_LANGUAGES) return -1;
+        languageNames.push_back(name);
+        return static_cast<int>(languageNames.size()) - 1;
+    }
+
+    size_t languageCount() const {
+        return languageNames.size();
+    }
+
+    const string& getLanguageName(size_t language) const {
+        return languageNames[language];
+    }
+
+    // Insert a word and its normalized version for the given language
+    void insert(const string& word, int language) {
+        if (language < 0 || language >= static_cast<int>(languageNames.size())) return;
+        LanguageMask bit = LanguageMask(1) << language;
+
+        // Insert exact form
+        TrieNodeRef* current = &root;
+        for (char ch : word) {
+            current = &arena.addChild(*current, static_cast<unsigned char>(ch));
+        }
+        arena.get(*current)->exactMask |= bit;
+
+        // Insert normalized only if different
+        std::string normalized = normalizeWord(word);
+        if (normalized != word) {
+            current = &root;
+            for (char ch : normalized) {
+                current = &arena.addChild(*current, static_cast<unsigned char>(ch));
+            }
+            arena.get(*current)->normalizedMask |= bit;
+        }
+    }
+
+    // Appends the keys insert() would store for a word: the word itself and,
+    // if different, its normalized form
+    static void wordEntries(const string& word, vector<TrieEntry>* entries) {
+        TrieEntry exact;
+        exact.key = word;
+        exact.exact = true;
+        entries->push_back(std::move(exact));
+
+        std::string normalized = normalizeWord(word);
+        if (normalized != word) {
+            TrieEntry entry;
+            entry.key = std::move(normalized);
+            entry.normalized = true;
+            entries->push_back(std::move(entry));
+        }
+    }
+
+    // Sorts entries by key and merges those with the same key, as
+    // insertSorted() expects
+    static void sortEntries(vector<TrieEntry>* entries) {
+        vector<uint32_t> order(entries->size());
+        vector<uint32_t> scratch(entries->size());
+        for (uint32_t i = 0; i < order.size(); ++i) order[i] = i;
+        radixSort(*entries, order.data(), order.data() + order.size(), 0, scratch.data());
+
+        vector<TrieEntry> sorted;
+        sorted.reserve(order.size());
+        for (uint32_t index : order) {
+            TrieEntry& entry = (*entries)[index];
+            if (!sorted.empty() && sorted.back().key == entry.key) {
+                sorted.back().exact |= entry.exact;
+                sorted.back().normalized |= entry.normalized;
+            } else {
+                sorted.push_back(std::move(entry));
+            }
+        }
+        entries->swap(sorted);
+    }
+
+    // Bulk insert for one language from entries sorted by key. Each key only
+    // walks the part that differs from the previous one, and new children
+    // are appended at the end of their parent, so building from a sorted
+    // list costs one step per new node.
+    void insertSorted(const vector<TrieEntry>& entries, int language) {
+        if (language < 0 || language >= static_cast<int>(languageNames.size())) return;
+        LanguageMask bit = LanguageMask(1) << language;
+
+        // path[d] is the slot holding the node at depth d of the previous
+        // key. Adding a child to a node may move it, which only invalidates
+        // the deeper slots, and those are dropped first.
+        vector<TrieNodeRef*> path(1, &root);
+        std::string_view previous;
+        for (const TrieEntry& entry : entries) {
+            size_t common = 0;
+            size_t limit = std::min(previous.size(), entry.key.size());
+            while (common < limit && previous[common] == entry.key[common]) ++common;
+            path.resize(common + 1);
+            for (size_t i = common; i < entry.key.size(); ++i) {
+                unsigned char index = static_cast<unsigned char>(entry.key[i]);
+                path.push_back(&arena.addChild(*path.back(), index));
+            }
+            TrieNode* node = arena.get(*path.back());
+            if (entry.exact) node->exactMask |= bit;
+            if (entry.normalized) node->normalizedMask |= bit;
+            previous = entry.key;
+        }
+    }
+
+    // Walks the trie once and reports every language matching the key. The
+    // key is used as-is, so callers looking up free text should normalize it
+    // first.
+    LanguageMatch lookup(std::string_view key) const {
+        LanguageMatch match;
+        const TrieNode* current = arena.get(root);
+        for (char ch : key) {
+            unsigned char index = static_cast<unsigned char>(ch);
+            TrieNodeRef child = current->findChild(index);
+            if (child == NO_NODE) return match;
+            current = arena.get(child);
+        }
+        match.exact = current->exactMask;
+        match.normalized = current->normalizedMask;
+        return match;
+    }
+
+    // 2 for an exact match, 1 for a match after normalization, 0 otherwise
+    int getMatchScore(const string& word, int language) const {
+        LanguageMask bit = LanguageMask(1) << language;
+        if (lookup(word).exact & bit) return 2;
+
+        // Do NOT skip if normalized == word (important!)
+        return (lookup(normalizeWord(word)).normalized & bit) ? 1 : 0;
+    }
+
+    // Read-only access to the nodes, e.g. for compiling a DictionaryImage
+    const TrieNode* getRoot() const {
+        return arena.get(root);
+    }
+
+    const TrieNode* getChild(const TrieNode* node, uint16_t i) const {
+        return arena.get(node->children()[i]);
+    }
+
+    // Number of nodes, including the root
+    size_t nodeCount() const {
+        return arena.nodeCount();
+    }
+
+    // Bytes of node storage the trie has taken from its arena
+    size_t memoryUsage() const {
+        return arena.memoryUsage();
+    }
+
+private:
+    // Most-significant-byte radix sort of entry indices whose keys agree on
+    // their first `depth` bytes. Touches each key byte about once instead of
+    // comparing whole strings log(n) times; small buckets use std::sort.
+    static void radixSort(const vector<TrieEntry>& entries, uint32_t* begin, uint32_t* end, size_t depth,
+                          uint32_t* scratch) {
+        if (end - begin < 32) {
+            std::sort(begin, end, [&entries, depth](uint32_t a, uint32_t b) {
+                return std::string_view(entries[a].key).substr(depth) <
+                       std::string_view(entries[b].key).substr(depth);
+            });
+            return;
+        }
+
+        // Bucket 0 holds keys that end here, bucket c + 1 those with byte c next
+        size_t starts[258] = {};
+        for (uint32_t* it = begin; it != end; ++it) ++starts[bucketOf(entries[*it].key, depth) + 1];
+        for (size_t bucket = 1; bucket < 258; ++bucket) starts[bucket] += starts[bucket - 1];
+
+        size_t next[257];
+        std::copy(starts, starts + 257, next);
+        for (uint32_t* it = begin; it != end; ++it) scratch[next[bucketOf(entries[*it].key, depth)]++] = *it;
+        std::copy(scratch, scratch + (end - begin), begin);
+
+        // Keys in bucket 0 are all equal, the rest continue one byte deeper
+        for (size_t bucket = 1; bucket < 257; ++bucket) {
+            if (starts[bucket + 1] - starts[bucket] > 1) {
+                radixSort(entries, begin + starts[bucket], begin + starts[bucket + 1], depth + 1, scratch);
+            }
+        }
+    }
+
+    static size_t bucketOf(const std::string& key, size_t depth) {
+        return depth < key.size() ? static_cast<unsigned char>(key[depth]) + 1 : 0;
+    }
+};
+
+#endif
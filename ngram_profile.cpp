@@ -0,0 +1,96 @@
+#include "ngram_profile.h"
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+using namespace std;
+
+// Calls visit(bucket) for every trigram and quadgram of "^word$". An n-gram
+// of at most four letters packs into 32 bits without collisions; the hash
+// only spreads those over the buckets.
+template <typename Visit>
+void NgramProfile::forEachGram(string_view word, Visit visit) {
+    size_t length = word.size() + 2;
+    auto byteAt = [&](size_t i) -> uint32_t {
+        if (i == 0) return '^';
+        if (i == length - 1) return '$';
+        return static_cast<unsigned char>(word[i - 1]);
+    };
+
+    for (size_t n = 3; n <= 4; ++n) {
+        for (size_t i = 0; i + n <= length; ++i) {
+            uint32_t packed = 0;
+            for (size_t k = 0; k < n; ++k) packed |= byteAt(i + k) << (8 * k);
+            visit((packed * 2654435761u) >> (32 - 14));
+        }
+    }
+}
+
+bool NgramProfile::build(const DictionaryImage& dictionary) {
+    static_assert(BUCKETS == (1 << 14), "forEachGram hashes to 14 bits");
+
+    languages = 0;
+    table.clear();
+    size_t count = dictionary.languageCount();
+    if (count == 0) return false;
+
+    // Each dictionary word is counted once, through its normalized form
+    vector<uint32_t> counts(BUCKETS * count, 0);
+    vector<double> totals(count, 0.0);
+    dictionary.forEachWord([&](string_view word, LanguageMatch match) {
+        for (char ch : word) {
+            if (ch < 'a' || ch > 'z') return;
+        }
+        LanguageMask mask = match.any();
+        forEachGram(word, [&](uint32_t bucket) {
+            for (LanguageMask bits = mask; bits; bits &= bits - 1) {
+                size_t language = static_cast<size_t>(__builtin_ctzll(bits));
+                ++counts[bucket * count + language];
+                totals[language] += 1;
+            }
+        });
+    });
+
+    // Add-one smoothed log-probabilities, so an unseen n-gram costs a
+    // language a lot but never rules it out
+    stride = (count + 3) & ~size_t(3);
+    table.assign(BUCKETS * stride, 0.0f);
+    for (size_t bucket = 0; bucket < BUCKETS; ++bucket) {
+        for (size_t language = 0; language < count; ++language) {
+            double probability = (counts[bucket * count + language] + 1.0) / (totals[language] + BUCKETS);
+            table[bucket * stride + language] = static_cast<float>(log(probability));
+        }
+    }
+    languages = count;
+    return true;
+}
+
+bool NgramProfile::score(string_view word, float* probabilities) const {
+    if (!languages || word.empty()) return false;
+
+    alignas(16) float sums[MAX_LANGUAGES] = {};
+    forEachGram(word, [&](uint32_t bucket) {
+        const float* row = &table[bucket * stride];
+#if defined(__SSE2__)
+        for (size_t i = 0; i < stride; i += 4) {
+            _mm_store_ps(sums + i, _mm_add_ps(_mm_load_ps(sums + i), _mm_loadu_ps(row + i)));
+        }
+#else
+        for (size_t i = 0; i < stride; ++i) sums[i] += row[i];
+#endif
+    });
+
+    // Naive Bayes with equal priors: softmax of the summed log-probabilities
+    float best = sums[0];
+    for (size_t i = 1; i < languages; ++i) best = max(best, sums[i]);
+    float total = 0.0f;
+    for (size_t i = 0; i < languages; ++i) {
+        probabilities[i] = exp(sums[i] - best);
+        total += probabilities[i];
+    }
+    for (size_t i = 0; i < languages; ++i) probabilities[i] /= total;
+    return true;
+}
@@ -0,0 +1,47 @@
+#ifndef NGRAM_PROFILE_H
+#define NGRAM_PROFILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+#include "dictionary_image.h"
+
+// Character n-gram model of every language in a dictionary, for words that
+// are in none of the word lists.
+//
+// The trigrams and quadgrams of each dictionary word (with '^' and '$' marking
+// the word boundaries) are hashed into a fixed number of buckets. A bucket
+// holds one smoothed log-probability per language, stored next to each other
+// and padded to a multiple of four, so scoring a word adds one short row of
+// floats per n-gram, four languages at a time with SSE.
+class NgramProfile {
+public:
+    static const size_t BUCKETS = 1 << 14;
+
+    // Counts the n-grams of every normalized word in the dictionary. Returns
+    // false if the dictionary is not loaded or has no languages.
+    bool build(const DictionaryImage& dictionary);
+
+    bool isBuilt() const { return languages != 0; }
+    size_t languageCount() const { return languages; }
+
+    // Writes one probability per language for a normalized word (lowercase
+    // ASCII letters). Returns false, leaving `probabilities` untouched, only
+    // if the profile is not built or the word is empty: the boundary marks
+    // give even a one-letter word the trigram "^a$", so callers that find
+    // short words too noisy must skip them themselves.
+    bool score(std::string_view word, float* probabilities) const;
+
+    size_t memoryUsage() const { return table.size() * sizeof(float); }
+
+private:
+    template <typename Visit>
+    static void forEachGram(std::string_view word, Visit visit);
+
+    size_t languages = 0;
+    size_t stride = 0;           // floats per bucket, languages rounded up to 4
+    std::vector<float> table;    // BUCKETS rows of `stride` log-probabilities
+};
+
+#endif
@@ -1,48 +1,321 @@
 #ifndef NORMALIZE_H
 #define NORMALIZE_H
 
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
 #include <string>
-#include <unordered_map>
-#include <cctype>
-
-// Map common UTF-8 accented characters (2-byte sequences) to ASCII
-const std::unordered_map<std::string, char> utf8_accent_map = {
-    {"\xC3\xA0", 'a'}, {"\xC3\xA1", 'a'}, {"\xC3\xA2", 'a'}, {"\xC3\xA3", 'a'}, {"\xC3\xA4", 'a'}, {"\xC3\xA5", 'a'},
-    {"\xC3\x80", 'a'}, {"\xC3\x81", 'a'}, {"\xC3\x82", 'a'}, {"\xC3\x83", 'a'}, {"\xC3\x84", 'a'}, {"\xC3\x85", 'a'},
-    {"\xC3\xA7", 'c'},  {"\xC3\x87", 'c'},
-    {"\xC3\xA8", 'e'}, {"\xC3\xA9", 'e'}, {"\xC3\xAA", 'e'}, {"\xC3\xAB", 'e'},
-    {"\xC3\x88", 'e'}, {"\xC3\x89", 'e'}, {"\xC3\x8A", 'e'}, {"\xC3\x8B", 'e'},
-    {"\xC3\xAC", 'i'}, {"\xC3\xAD", 'i'}, {"\xC3\xAE", 'i'}, {"\xC3\xAF", 'i'},
-    {"\xC3\x8C", 'i'}, {"\xC3\x8D", 'i'}, {"\xC3\x8E", 'i'}, {"\xC3\x8F", 'i'},
-    {"\xC3\xB1", 'n'}, {"\xC3\x91", 'n'},
-    {"\xC3\xB2", 'o'}, {"\xC3\xB3", 'o'}, {"\xC3\xB4", 'o'}, {"\xC3\xB5", 'o'}, {"\xC3\xB6", 'o'},
-    {"\xC3\x92", 'o'}, {"\xC3\x93", 'o'}, {"\xC3\x94", 'o'}, {"\xC3\x95", 'o'}, {"\xC3\x96", 'o'},
-    {"\xC3\x99", 'u'}, {"\xC3\x9A", 'u'}, {"\xC3\x9B", 'u'}, {"\xC3\x9C", 'u'},
-    {"\xC3\xB9", 'u'}, {"\xC3\xBA", 'u'}, {"\xC3\xBB", 'u'}, {"\xC3\xBC", 'u'},
-    {"\xC3\xBD", 'y'}, {"\xC3\xBF", 'y'},
-    {"\xC3\x9F", 's'}
+#include <string_view>
+
+// LANGWITCH_NO_SIMD leaves out the SSE2 path, so tests can compare it with
+// the scalar ones
+#if defined(__SSE2__) && !defined(LANGWITCH_NO_SIMD)
+#include <emmintrin.h>
+#endif
+
+namespace normalize_detail {
+
+// ASCII letters map to their lowercase form; every other byte maps to 0 and
+// is dropped
+struct AsciiFoldTable {
+    unsigned char fold[256];
+
+    constexpr AsciiFoldTable() : fold() {
+        for (int c = 'a'; c <= 'z'; ++c) fold[c] = static_cast<unsigned char>(c);
+        for (int c = 'A'; c <= 'Z'; ++c) fold[c] = static_cast<unsigned char>(c - 'A' + 'a');
+    }
+};
+
+inline constexpr AsciiFoldTable asciiFold{};
+
+// UTF-8 decoding DFA. Every byte falls in one of 12 classes; the state after
+// a byte is transitions[state + class], with states premultiplied by the
+// class count. A sequence is complete on returning to UTF8_ACCEPT and
+// malformed (overlong, surrogate, above U+10FFFF, cut short) on reaching
+// UTF8_REJECT.
+enum : uint8_t {
+    UTF8_ACCEPT = 0,
+    UTF8_REJECT = 12,
+};
+
+// 0: ASCII, 1: 80-8F, 2: 90-9F, 3: A0-BF, 4: C2-DF, 5: E0, 6: E1-EC EE-EF,
+// 7: ED, 8: F0, 9: F1-F3, 10: F4, 11: never valid (C0 C1 F5-FF)
+struct Utf8ByteClasses {
+    uint8_t of[256];
+
+    constexpr Utf8ByteClasses() : of() {
+        for (int b = 0x80; b <= 0x8F; ++b) of[b] = 1;
+        for (int b = 0x90; b <= 0x9F; ++b) of[b] = 2;
+        for (int b = 0xA0; b <= 0xBF; ++b) of[b] = 3;
+        for (int b = 0xC0; b <= 0xC1; ++b) of[b] = 11;
+        for (int b = 0xC2; b <= 0xDF; ++b) of[b] = 4;
+        of[0xE0] = 5;
+        for (int b = 0xE1; b <= 0xEF; ++b) of[b] = 6;
+        of[0xED] = 7;
+        of[0xF0] = 8;
+        for (int b = 0xF1; b <= 0xF3; ++b) of[b] = 9;
+        of[0xF4] = 10;
+        for (int b = 0xF5; b <= 0xFF; ++b) of[b] = 11;
+    }
+};
+
+inline constexpr Utf8ByteClasses utf8Class{};
+
+// Payload bits a lead byte of each class contributes
+inline constexpr uint8_t utf8LeadMask[12] = {0x7F, 0, 0, 0, 0x1F, 0x0F, 0x0F, 0x0F, 0x07, 0x07, 0x07, 0};
+
+// States: 0 accept, 12 reject, 24 one continuation left, 36 two left,
+// 48 after E0 (A0-BF next), 60 after ED (80-9F next), 72 three left,
+// 84 after F0 (90-BF next), 96 after F4 (80-8F next)
+inline constexpr uint8_t utf8Transitions[108] = {
+    //  asc  80   90   A0   C2   E0   E1   ED   F0   F1   F4   bad
+         0,  12,  12,  12,  24,  48,  36,  60,  84,  72,  96,  12,   // accept
+        12,  12,  12,  12,  12,  12,  12,  12,  12,  12,  12,  12,   // reject
+        12,   0,   0,   0,  12,  12,  12,  12,  12,  12,  12,  12,   // 1 left
+        12,  24,  24,  24,  12,  12,  12,  12,  12,  12,  12,  12,   // 2 left
+        12,  12,  12,  24,  12,  12,  12,  12,  12,  12,  12,  12,   // E0
+        12,  24,  24,  12,  12,  12,  12,  12,  12,  12,  12,  12,   // ED
+        12,  36,  36,  36,  12,  12,  12,  12,  12,  12,  12,  12,   // 3 left
+        12,  12,  36,  36,  12,  12,  12,  12,  12,  12,  12,  12,   // F0
+        12,  36,  12,  12,  12,  12,  12,  12,  12,  12,  12,  12,   // F4
 };
 
-std::string normalizeWord(const std::string& word) {
-    std::string normalized;
-    for (size_t i = 0; i < word.size(); ) {
-        // If it's a 2-byte UTF-8 sequence
-        if ((unsigned char)word[i] == 0xC3 && i + 1 < word.size()) {
-            std::string seq = word.substr(i, 2);
-            if (utf8_accent_map.count(seq)) {
-                normalized += utf8_accent_map.at(seq);
-                i += 2;
+const uint32_t INVALID_CODEPOINT = 0xFFFFFFFF;
+
+// Decodes the character starting at word[i] into `codepoint` and returns
+// the bytes it took. A malformed sequence yields INVALID_CODEPOINT and takes
+// its longest valid prefix (at least one byte), so the byte that broke it
+// starts the next character.
+inline size_t decodeUtf8(const char* word, size_t length, size_t i, uint32_t& codepoint) {
+    uint32_t state = UTF8_ACCEPT;
+    uint32_t code = 0;
+    size_t j = i;
+    do {
+        unsigned char byte = static_cast<unsigned char>(word[j]);
+        uint8_t byteClass = utf8Class.of[byte];
+        code = (state == UTF8_ACCEPT) ? (byte & utf8LeadMask[byteClass]) : (code << 6) | (byte & 0x3F);
+        state = utf8Transitions[state + byteClass];
+        ++j;
+    } while (state > UTF8_REJECT && j < length);
+
+    if (state == UTF8_ACCEPT) {
+        codepoint = code;
+        return j - i;
+    }
+    codepoint = INVALID_CODEPOINT;
+    if (state == UTF8_REJECT && j - i > 1) return j - i - 1;
+    return j - i;
+}
+
+// Folds U+0080-U+024F (Latin-1 Supplement, Latin Extended-A and -B). An
+// entry is either up to two ASCII letters, first in the low byte ("ß" is
+// "ss", "ł" is "l"), or, with the top bit set, the lowercase codepoint of a
+// letter without an ASCII equivalent. 0 drops a symbol or control character.
+const uint32_t LATIN_FOLD_BEGIN = 0x80;
+const uint32_t LATIN_FOLD_END = 0x250;
+const uint16_t KEEP_CODEPOINT = 0x8000;
+
+inline constexpr uint16_t latinFold[LATIN_FOLD_END - LATIN_FOLD_BEGIN] = {
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,  // U+0080 . . . . . . . .
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,  // U+0088 . . . . . . . .
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,  // U+0090 . . . . . . . .
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,  // U+0098 . . . . . . . .
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,  // U+00A0   ¡ ¢ £ ¤ ¥ ¦ §
+    0x0000, 0x0000, 0x0061, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,  // U+00A8 ¨ © ª « ¬ . ® ¯
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x80B5, 0x0000, 0x0000,  // U+00B0 ° ± ² ³ ´ µ ¶ ·
+    0x0000, 0x0000, 0x006F, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,  // U+00B8 ¸ ¹ º » ¼ ½ ¾ ¿
+    0x0061, 0x0061, 0x0061, 0x0061, 0x0061, 0x0061, 0x6561, 0x0063,  // U+00C0 À Á Â Ã Ä Å Æ Ç
+    0x0065, 0x0065, 0x0065, 0x0065, 0x0069, 0x0069, 0x0069, 0x0069,  // U+00C8 È É Ê Ë Ì Í Î Ï
+    0x0064, 0x006E, 0x006F, 0x006F, 0x006F, 0x006F, 0x006F, 0x0000,  // U+00D0 Ð Ñ Ò Ó Ô Õ Ö ×
+    0x006F, 0x0075, 0x0075, 0x0075, 0x0075, 0x0079, 0x6874, 0x7373,  // U+00D8 Ø Ù Ú Û Ü Ý Þ ß
+    0x0061, 0x0061, 0x0061, 0x0061, 0x0061, 0x0061, 0x6561, 0x0063,  // U+00E0 à á â ã ä å æ ç
+    0x0065, 0x0065, 0x0065, 0x0065, 0x0069, 0x0069, 0x0069, 0x0069,  // U+00E8 è é ê ë ì í î ï
+    0x0064, 0x006E, 0x006F, 0x006F, 0x006F, 0x006F, 0x006F, 0x0000,  // U+00F0 ð ñ ò ó ô õ ö ÷
+    0x006F, 0x0075, 0x0075, 0x0075, 0x0075, 0x0079, 0x6874, 0x0079,  // U+00F8 ø ù ú û ü ý þ ÿ
+    0x0061, 0x0061, 0x0061, 0x0061, 0x0061, 0x0061, 0x0063, 0x0063,  // U+0100 Ā ā Ă ă Ą ą Ć ć
+    0x0063, 0x0063, 0x0063, 0x0063, 0x0063, 0x0063, 0x0064, 0x0064,  // U+0108 Ĉ ĉ Ċ ċ Č č Ď ď
+    0x0064, 0x0064, 0x0065, 0x0065, 0x0065, 0x0065, 0x0065, 0x0065,  // U+0110 Đ đ Ē ē Ĕ ĕ Ė ė
+    0x0065, 0x0065, 0x0065, 0x0065, 0x0067, 0x0067, 0x0067, 0x0067,  // U+0118 Ę ę Ě ě Ĝ ĝ Ğ ğ
+    0x0067, 0x0067, 0x0067, 0x0067, 0x0068, 0x0068, 0x0068, 0x0068,  // U+0120 Ġ ġ Ģ ģ Ĥ ĥ Ħ ħ
+    0x0069, 0x0069, 0x0069, 0x0069, 0x0069, 0x0069, 0x0069, 0x0069,  // U+0128 Ĩ ĩ Ī ī Ĭ ĭ Į į
+    0x0069, 0x0069, 0x6A69, 0x6A69, 0x006A, 0x006A, 0x006B, 0x006B,  // U+0130 İ ı Ĳ ĳ Ĵ ĵ Ķ ķ
+    0x006B, 0x006C, 0x006C, 0x006C, 0x006C, 0x006C, 0x006C, 0x006C,  // U+0138 ĸ Ĺ ĺ Ļ ļ Ľ ľ Ŀ
+    0x006C, 0x006C, 0x006C, 0x006E, 0x006E, 0x006E, 0x006E, 0x006E,  // U+0140 ŀ Ł ł Ń ń Ņ ņ Ň
+    0x006E, 0x006E, 0x006E, 0x006E, 0x006F, 0x006F, 0x006F, 0x006F,  // U+0148 ň ŉ Ŋ ŋ Ō ō Ŏ ŏ
+    0x006F, 0x006F, 0x656F, 0x656F, 0x0072, 0x0072, 0x0072, 0x0072,  // U+0150 Ő ő Œ œ Ŕ ŕ Ŗ ŗ
+    0x0072, 0x0072, 0x0073, 0x0073, 0x0073, 0x0073, 0x0073, 0x0073,  // U+0158 Ř ř Ś ś Ŝ ŝ Ş ş
+    0x0073, 0x0073, 0x0074, 0x0074, 0x0074, 0x0074, 0x0074, 0x0074,  // U+0160 Š š Ţ ţ Ť ť Ŧ ŧ
+    0x0075, 0x0075, 0x0075, 0x0075, 0x0075, 0x0075, 0x0075, 0x0075,  // U+0168 Ũ ũ Ū ū Ŭ ŭ Ů ů
+    0x0075, 0x0075, 0x0075, 0x0075, 0x0077, 0x0077, 0x0079, 0x0079,  // U+0170 Ű ű Ų ų Ŵ ŵ Ŷ ŷ
+    0x0079, 0x007A, 0x007A, 0x007A, 0x007A, 0x007A, 0x007A, 0x0073,  // U+0178 Ÿ Ź ź Ż ż Ž ž ſ
+    0x0062, 0x0062, 0x0062, 0x0062, 0x8185, 0x8185, 0x8254, 0x0063,  // U+0180 ƀ Ɓ Ƃ ƃ Ƅ ƅ Ɔ Ƈ
+    0x0063, 0x8256, 0x0064, 0x0064, 0x0064, 0x818D, 0x81DD, 0x8259,  // U+0188 ƈ Ɖ Ɗ Ƌ ƌ ƍ Ǝ Ə
+    0x825B, 0x0066, 0x0066, 0x0067, 0x8263, 0x7668, 0x8269, 0x0069,  // U+0190 Ɛ Ƒ ƒ Ɠ Ɣ ƕ Ɩ Ɨ
+    0x006B, 0x006B, 0x006C, 0x819B, 0x826F, 0x006E, 0x006E, 0x006F,  // U+0198 Ƙ ƙ ƚ ƛ Ɯ Ɲ ƞ Ɵ
+    0x006F, 0x006F, 0x696F, 0x696F, 0x0070, 0x0070, 0x8280, 0x81A8,  // U+01A0 Ơ ơ Ƣ ƣ Ƥ ƥ Ʀ Ƨ
+    0x81A8, 0x8283, 0x81AA, 0x0074, 0x0074, 0x0074, 0x0074, 0x0075,  // U+01A8 ƨ Ʃ ƪ ƫ Ƭ ƭ Ʈ Ư
+    0x0075, 0x828A, 0x0076, 0x0079, 0x0079, 0x007A, 0x007A, 0x8292,  // U+01B0 ư Ʊ Ʋ Ƴ ƴ Ƶ ƶ Ʒ
+    0x81B9, 0x81B9, 0x81BA, 0x81BB, 0x81BD, 0x81BD, 0x81BE, 0x81BF,  // U+01B8 Ƹ ƹ ƺ ƻ Ƽ ƽ ƾ ƿ
+    0x81C0, 0x81C1, 0x81C2, 0x81C3, 0x7A64, 0x7A64, 0x7A64, 0x6A6C,  // U+01C0 ǀ ǁ ǂ ǃ Ǆ ǅ ǆ Ǉ
+    0x6A6C, 0x6A6C, 0x6A6E, 0x6A6E, 0x6A6E, 0x0061, 0x0061, 0x0069,  // U+01C8 ǈ ǉ Ǌ ǋ ǌ Ǎ ǎ Ǐ
+    0x0069, 0x006F, 0x006F, 0x0075, 0x0075, 0x0075, 0x0075, 0x0075,  // U+01D0 ǐ Ǒ ǒ Ǔ ǔ Ǖ ǖ Ǘ
+    0x0075, 0x0075, 0x0075, 0x0075, 0x0075, 0x81DD, 0x0061, 0x0061,  // U+01D8 ǘ Ǚ ǚ Ǜ ǜ ǝ Ǟ ǟ
+    0x0061, 0x0061, 0x6561, 0x6561, 0x0067, 0x0067, 0x0067, 0x0067,  // U+01E0 Ǡ ǡ Ǣ ǣ Ǥ ǥ Ǧ ǧ
+    0x006B, 0x006B, 0x006F, 0x006F, 0x006F, 0x006F, 0x81EF, 0x81EF,  // U+01E8 Ǩ ǩ Ǫ ǫ Ǭ ǭ Ǯ ǯ
+    0x006A, 0x7A64, 0x7A64, 0x7A64, 0x0067, 0x0067, 0x8195, 0x81BF,  // U+01F0 ǰ Ǳ ǲ ǳ Ǵ ǵ Ƕ Ƿ
+    0x006E, 0x006E, 0x0061, 0x0061, 0x6561, 0x6561, 0x006F, 0x006F,  // U+01F8 Ǹ ǹ Ǻ ǻ Ǽ ǽ Ǿ ǿ
+    0x0061, 0x0061, 0x0061, 0x0061, 0x0065, 0x0065, 0x0065, 0x0065,  // U+0200 Ȁ ȁ Ȃ ȃ Ȅ ȅ Ȇ ȇ
+    0x0069, 0x0069, 0x0069, 0x0069, 0x006F, 0x006F, 0x006F, 0x006F,  // U+0208 Ȉ ȉ Ȋ ȋ Ȍ ȍ Ȏ ȏ
+    0x0072, 0x0072, 0x0072, 0x0072, 0x0075, 0x0075, 0x0075, 0x0075,  // U+0210 Ȑ ȑ Ȓ ȓ Ȕ ȕ Ȗ ȗ
+    0x0073, 0x0073, 0x0074, 0x0074, 0x821D, 0x821D, 0x0068, 0x0068,  // U+0218 Ș ș Ț ț Ȝ ȝ Ȟ ȟ
+    0x006E, 0x0064, 0x756F, 0x756F, 0x007A, 0x007A, 0x0061, 0x0061,  // U+0220 Ƞ ȡ Ȣ ȣ Ȥ ȥ Ȧ ȧ
+    0x0065, 0x0065, 0x006F, 0x006F, 0x006F, 0x006F, 0x006F, 0x006F,  // U+0228 Ȩ ȩ Ȫ ȫ Ȭ ȭ Ȯ ȯ
+    0x006F, 0x006F, 0x0079, 0x0079, 0x006C, 0x006E, 0x0074, 0x8237,  // U+0230 Ȱ ȱ Ȳ ȳ ȴ ȵ ȶ ȷ
+    0x8238, 0x8239, 0x0061, 0x0063, 0x0063, 0x006C, 0x0074, 0x0073,  // U+0238 ȸ ȹ Ⱥ Ȼ ȼ Ƚ Ⱦ ȿ
+    0x007A, 0x8242, 0x8242, 0x0062, 0x8289, 0x828C, 0x0065, 0x0065,  // U+0240 ɀ Ɂ ɂ Ƀ Ʉ Ʌ Ɇ ɇ
+    0x006A, 0x006A, 0x824B, 0x0071, 0x0072, 0x0072, 0x0079, 0x0079,  // U+0248 Ɉ ɉ Ɋ ɋ Ɍ ɍ Ɏ ɏ
+};
+
+// Lowercase of a codepoint past the Latin table, for the scripts with simple
+// case pairs (Greek, Cyrillic, Latin Extended Additional); others unchanged
+inline uint32_t lowercaseCodepoint(uint32_t cp) {
+    if (cp >= 0x391 && cp <= 0x3A9 && cp != 0x3A2) return cp + 0x20;  // Greek capitals
+    if (cp == 0x3C2) return 0x3C3;                                    // final sigma
+    if (cp == 0x386) return 0x3AC;
+    if (cp >= 0x388 && cp <= 0x38A) return cp + 0x25;
+    if (cp == 0x38C) return 0x3CC;
+    if (cp == 0x38E || cp == 0x38F) return cp + 0x3F;
+    if (cp >= 0x410 && cp <= 0x42F) return cp + 0x20;                 // Cyrillic capitals
+    if (cp >= 0x400 && cp <= 0x40F) return cp + 0x50;
+    if (((cp >= 0x460 && cp <= 0x481) || (cp >= 0x48A && cp <= 0x4BF) || (cp >= 0x4D0 && cp <= 0x4FF) ||
+         (cp >= 0x1E00 && cp <= 0x1E95) || (cp >= 0x1EA0 && cp <= 0x1EFF)) && !(cp & 1)) {
+        return cp + 1;                                                // alternating case pairs
+    }
+    if (cp >= 0x4C1 && cp <= 0x4CE && (cp & 1)) return cp + 1;
+    if (cp == 0x4C0) return 0x4CF;
+    return cp;
+}
+
+// True for codepoints that are never part of a word: combining marks,
+// punctuation and symbol blocks, private use, emoji and format characters
+inline bool isDroppedCodepoint(uint32_t cp) {
+    return (cp >= 0x300 && cp <= 0x36F) || (cp >= 0x483 && cp <= 0x489) || (cp >= 0x2000 && cp <= 0x2BFF) ||
+           (cp >= 0x3000 && cp <= 0x303F) || (cp >= 0xE000 && cp <= 0xF8FF) || (cp >= 0xFE00 && cp <= 0xFE0F) ||
+           cp == 0xFEFF || (cp >= 0x1F000 && cp <= 0x1FFFF) || cp >= 0xE0000;
+}
+
+inline size_t encodeUtf8(uint32_t cp, char* out) {
+    if (cp < 0x800) {
+        out[0] = static_cast<char>(0xC0 | (cp >> 6));
+        out[1] = static_cast<char>(0x80 | (cp & 0x3F));
+        return 2;
+    }
+    if (cp < 0x10000) {
+        out[0] = static_cast<char>(0xE0 | (cp >> 12));
+        out[1] = static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out[2] = static_cast<char>(0x80 | (cp & 0x3F));
+        return 3;
+    }
+    out[0] = static_cast<char>(0xF0 | (cp >> 18));
+    out[1] = static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+    out[2] = static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+    out[3] = static_cast<char>(0x80 | (cp & 0x3F));
+    return 4;
+}
+
+// Writes the folded form of a non-ASCII codepoint and returns its length,
+// never more than the codepoint's own UTF-8 length
+inline size_t foldCodepoint(uint32_t cp, char* out) {
+    if (cp < LATIN_FOLD_END) {
+        uint16_t entry = latinFold[cp - LATIN_FOLD_BEGIN];
+        if (entry & KEEP_CODEPOINT) return encodeUtf8(entry & ~KEEP_CODEPOINT, out);
+        out[0] = static_cast<char>(entry & 0xFF);
+        out[1] = static_cast<char>(entry >> 8);
+        return (entry & 0xFF ? 1 : 0) + (entry >> 8 ? 1 : 0);
+    }
+    if (cp == INVALID_CODEPOINT || isDroppedCodepoint(cp)) return 0;
+    return encodeUtf8(lowercaseCodepoint(cp), out);
+}
+
+// True when all eight bytes are ASCII letters; `lower` receives them in
+// lowercase
+inline bool foldEightLetters(const char* in, uint64_t& lower) {
+    const uint64_t ones = 0x0101010101010101ULL;
+    const uint64_t highBits = 0x8080808080808080ULL;
+    uint64_t chunk;
+    std::memcpy(&chunk, in, sizeof(chunk));
+    if (chunk & highBits) return false;
+
+    lower = chunk | (ones * 0x20);
+    uint64_t atLeastA = lower + ones * (0x80 - 'a');        // high bit set if byte >= 'a'
+    uint64_t pastZ = lower + ones * (0x80 - ('z' + 1));     // high bit set if byte > 'z'
+    return (atLeastA & ~pastZ & highBits) == highBits;
+}
+
+} // namespace normalize_detail
+
+// Lowercases ASCII letters, maps accented and other Latin letters to their
+// ASCII base letters ("é" is "e", "œ" is "oe"), lowercases letters of other
+// scripts and drops digits, punctuation, symbols, combining marks and
+// malformed UTF-8. Writes into `out`, which must have room for `length` bytes
+// (the result is never longer than the input), and returns the number of
+// bytes written. Runs of plain ASCII letters are handled 16 (SSE2) or 8 bytes
+// at a time; other characters go through the UTF-8 DFA.
+inline size_t normalizeWordInto(const char* word, size_t length, char* out) {
+    using namespace normalize_detail;
+
+    size_t written = 0;
+    size_t i = 0;
+    while (i < length) {
+#if defined(__SSE2__) && !defined(LANGWITCH_NO_SIMD)
+        if (length - i >= 16) {
+            __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(word + i));
+            __m128i lower = _mm_or_si128(chunk, _mm_set1_epi8(0x20));
+            // Bytes >= 0x80 are negative as signed chars and fail the first test
+            __m128i letters = _mm_and_si128(_mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)),
+                                            _mm_cmplt_epi8(lower, _mm_set1_epi8('z' + 1)));
+            if (_mm_movemask_epi8(letters) == 0xFFFF) {
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out + written), lower);
+                i += 16;
+                written += 16;
                 continue;
             }
         }
+#endif
+        uint64_t lower;
+        if (length - i >= 8 && foldEightLetters(word + i, lower)) {
+            std::memcpy(out + written, &lower, sizeof(lower));
+            i += 8;
+            written += 8;
+            continue;
+        }
 
-        // Handle ASCII chars
-        char ch = word[i];
-        if ((unsigned char)ch < 128 && std::isalpha(ch)) {
-            normalized += std::tolower(ch);
+        // Scalar path: one character, then try the wide paths again
+        unsigned char c = static_cast<unsigned char>(word[i]);
+        if (c < 0x80) {
+            unsigned char folded = asciiFold.fold[c];
+            if (folded) out[written++] = static_cast<char>(folded);
+            i++;
+            continue;
+        }
+        // Two-byte characters (all of Latin, Greek and Cyrillic) skip the DFA
+        if (c >= 0xC2 && c <= 0xDF && i + 1 < length &&
+            (static_cast<unsigned char>(word[i + 1]) & 0xC0) == 0x80) {
+            written += foldCodepoint(((c & 0x1Fu) << 6) | (word[i + 1] & 0x3Fu), out + written);
+            i += 2;
+            continue;
         }
-        i++;
+        uint32_t codepoint;
+        size_t taken = decodeUtf8(word, length, i, codepoint);
+        written += foldCodepoint(codepoint, out + written);
+        i += taken;
     }
+    return written;
+}
+
+inline std::string normalizeWord(std::string_view word) {
+    std::string normalized(word.size(), '\0');
+    normalized.resize(normalizeWordInto(word.data(), word.size(), &normalized[0]));
     return normalized;
 }
 
@@ -0,0 +1,154 @@
+#include "segmenter.h"
+#include <cmath>
+
+using namespace std;
+
+// Scores are stored as multiples of 1/WEIGHT_SCALE so window sums are exact
+static const float WEIGHT_SCALE = 4096.0f;
+
+Segmenter::Segmenter(const DictionaryImage& dictionary, const DetectionOptions& options,
+                     const SegmentOptions& segmentOptions, SpanCallback emit)
+    : options(options), emit(std::move(emit)), scorer(dictionary, options) {
+    languageCount = dictionary.languageCount();
+    window = segmentOptions.window ? segmentOptions.window : 1;
+    ahead = (window - 1) / 2;
+    minSpanTokens = segmentOptions.minSpanTokens;
+    scores.assign(window * languageCount, 0);
+    begins.assign(window, 0);
+    ends.assign(window, 0);
+    sums.assign(languageCount, 0);
+}
+
+bool Segmenter::feed(string_view chunk) {
+    if (stopped) return false;
+    if (options.cancel && options.cancel->load(memory_order_relaxed)) {
+        stopped = true;
+        return false;
+    }
+
+    tokens.feed(chunk);
+    string_view word;
+    size_t offset;
+    while (!stopped && tokens.next(word, offset)) processToken(word, offset);
+    return !stopped;
+}
+
+void Segmenter::processToken(string_view word, size_t offset) {
+    if (options.cancel && (pushed & (DetectionOptions::CANCEL_POLL_INTERVAL - 1)) == 0 &&
+        options.cancel->load(memory_order_relaxed)) {
+        stopped = true;
+        return;
+    }
+
+    // The word leaving the window was labelled already
+    if (pushed - oldest == window) {
+        const int32_t* evicted = &scores[(oldest % window) * languageCount];
+        for (size_t i = 0; i < languageCount; ++i) sums[i] -= evicted[i];
+        ++oldest;
+    }
+
+    size_t slot = pushed % window;
+    int32_t* added = &scores[slot * languageCount];
+    // Only the diagonal counts here: what the word adds to each language
+    WordScore score;
+    bool scored = scorer.score(word, &score);
+    LanguageMask matched = score.kind == WordMatch::NONE ? ~LanguageMask(0) : score.languages;
+    for (size_t i = 0; i < languageCount; ++i) {
+        bool counts = scored && (matched >> i & 1);
+        added[i] = counts ? static_cast<int32_t>(lround(score.weights[i] * WEIGHT_SCALE)) : 0;
+        sums[i] += added[i];
+    }
+    begins[slot] = offset;
+    ends[slot] = offset + word.size();
+    ++pushed;
+
+    // The window of the word `ahead` back is now complete
+    if (pushed > ahead) labelOldestPending();
+}
+
+// Labels the first unlabelled word with the language leading the window;
+// ties go to the language registered first
+void Segmenter::labelOldestPending() {
+    int best = -1;
+    int64_t bestSum = 0;
+    for (size_t i = 0; i < languageCount; ++i) {
+        if (sums[i] > bestSum) {
+            bestSum = sums[i];
+            best = static_cast<int>(i);
+        }
+    }
+    size_t slot = labelled % window;
+    addLabel(best, begins[slot], ends[slot]);
+    ++labelled;
+}
+
+void Segmenter::addLabel(int language, size_t begin, size_t end) {
+    if (current.tokens == 0) {
+        current = {begin, end, language, 1};
+        return;
+    }
+    if (language == current.language) {
+        // The change of language was a blip, it belongs to this span
+        if (candidate.tokens) {
+            current.tokens += candidate.tokens;
+            candidate = LanguageSpan();
+        }
+        current.end = end;
+        ++current.tokens;
+        return;
+    }
+
+    if (candidate.tokens && candidate.language == language) {
+        candidate.end = end;
+        ++candidate.tokens;
+    } else {
+        if (candidate.tokens) {
+            current.end = candidate.end;
+            current.tokens += candidate.tokens;
+        }
+        candidate = {begin, end, language, 1};
+    }
+
+    if (candidate.tokens >= minSpanTokens) {
+        emit(current);
+        current = candidate;
+        candidate = LanguageSpan();
+    }
+}
+
+void Segmenter::finish() {
+    string_view word;
+    size_t offset;
+    if (tokens.finish(word, offset) && !stopped) processToken(word, offset);
+
+    // The last words see a window cut short on the right
+    size_t behind = window - 1 - ahead;
+    while (!stopped && labelled < pushed) {
+        while (oldest + behind < labelled) {
+            const int32_t* evicted = &scores[(oldest % window) * languageCount];
+            for (size_t i = 0; i < languageCount; ++i) sums[i] -= evicted[i];
+            ++oldest;
+        }
+        labelOldestPending();
+    }
+    stopped = true;
+    scorer.finish(tokens.size(), pushed);
+
+    if (candidate.tokens) {
+        current.end = candidate.end;
+        current.tokens += candidate.tokens;
+        candidate = LanguageSpan();
+    }
+    if (current.tokens) emit(current);
+    current = LanguageSpan();
+}
+
+vector<LanguageSpan> segmentLanguages(string_view text, const DictionaryImage& dictionary,
+                                      const DetectionOptions& options, const SegmentOptions& segmentOptions) {
+    vector<LanguageSpan> spans;
+    Segmenter segmenter(dictionary, options, segmentOptions,
+                        [&spans](const LanguageSpan& span) { spans.push_back(span); });
+    segmenter.feed(text);
+    segmenter.finish();
+    return spans;
+}
@@ -0,0 +1,90 @@
+#ifndef SEGMENTER_H
+#define SEGMENTER_H
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "language_detector.h"
+
+// A run of input in one language, from the first byte of its first word to
+// the last byte of its last word. `language` indexes the dictionary's
+// languages, or is -1 where no word was evidence for any language.
+struct LanguageSpan {
+    size_t begin = 0;
+    size_t end = 0;
+    int language = -1;
+    size_t tokens = 0;   // words in the span
+};
+
+struct SegmentOptions {
+    // Words each label is decided from, centred on the word labelled. Larger
+    // windows ride over stray words, smaller ones find shorter spans.
+    size_t window = 16;
+
+    // A change of language shorter than this many words is folded into the
+    // span around it instead of starting a span of its own
+    size_t minSpanTokens = 4;
+};
+
+// Splits input in several languages into spans, reading it in pieces like
+// StreamingDetector.
+//
+// Every word is scored once and kept in a ring of the last `window` words
+// together with the running per-language sum of their scores. Each new word
+// adds its scores and the word leaving the window takes its scores back out,
+// so a label costs O(languages) whatever the window size, and memory stays
+// at one window of scores however long the input. Scores are fixed-point, so
+// the running sums never drift from what resumming the window would give.
+class Segmenter {
+public:
+    using SpanCallback = std::function<void(const LanguageSpan& span)>;
+
+    // Spans are passed to `emit` in input order as soon as they are final
+    Segmenter(const DictionaryImage& dictionary, const DetectionOptions& options, const SegmentOptions& segmentOptions,
+              SpanCallback emit);
+
+    // Processes the next piece of input. Returns false if
+    // DetectionOptions::cancel was set; further input is ignored.
+    bool feed(std::string_view chunk);
+
+    // Labels the words still waiting for the rest of their window and emits
+    // the last span
+    void finish();
+
+private:
+    void processToken(std::string_view word, size_t offset);
+    void labelOldestPending();
+    void addLabel(int language, size_t begin, size_t end);
+
+    DetectionOptions options;
+    SpanCallback emit;
+    WordScorer scorer;
+    ChunkTokenizer tokens;
+    size_t languageCount;
+    size_t window;
+    size_t ahead;            // words after the labelled one in its window
+    size_t minSpanTokens;
+
+    // Ring of the last `window` words, by word number modulo `window`
+    std::vector<int32_t> scores;    // window x languageCount
+    std::vector<size_t> begins;
+    std::vector<size_t> ends;
+    std::vector<int64_t> sums;      // scores of the words in the window, per language
+    uint64_t pushed = 0;            // words seen so far
+    uint64_t oldest = 0;            // first word still in the window
+    uint64_t labelled = 0;          // words labelled so far
+
+    LanguageSpan current;           // span being grown, not yet emitted
+    LanguageSpan candidate;         // a change of language not yet long enough
+
+    bool stopped = false;
+};
+
+// Segments a whole text at once
+std::vector<LanguageSpan> segmentLanguages(std::string_view text, const DictionaryImage& dictionary,
+                                           const DetectionOptions& options = DetectionOptions(),
+                                           const SegmentOptions& segmentOptions = SegmentOptions());
+
+#endif
@@ -0,0 +1,697 @@
+#include "embedded_dictionary.h"
+#include "json_util.h"
+#include "language_detector.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace std;
+using Clock = chrono::steady_clock;
+
+static void printUsage(const char* program) {
+    cerr << "Usage: " << program << " [options]\n"
+         << "\n"
+         << "Loads the dictionaries once and serves detection over HTTP/1.1 on a Unix\n"
+         << "domain socket and/or a localhost TCP port. Requests that arrive while every\n"
+         << "worker is busy are coalesced into batches.\n"
+         << "\n"
+         << "  POST /detect          body is the text; replies with one JSON result\n"
+         << "  POST /detect?matrix=1 same, with the word match matrix\n"
+         << "  GET  /stats           queue depth, batch sizes and latency percentiles\n"
+         << "\n"
+         << "Options:\n"
+         << "  --socket PATH    listen on a Unix domain socket (default: /tmp/langwitch.sock\n"
+         << "                   when no --port is given)\n"
+         << "  --port N         listen on 127.0.0.1:N\n"
+         << "  --dict-dir DIR   directory holding languages.manifest or *.txt word lists\n"
+         << "                   (default: $LANGWITCH_DATA_DIR or a manifest next to the\n"
+         << "                   program, else the dictionary built into the program)\n"
+         << "  --dictionary F   use an image built by langwitch-compile instead\n"
+         << "  --threads N      worker threads (default: all cores)\n"
+         << "  --max-batch N    most requests handed to a worker at once (default: 64)\n"
+         << "  --max-body N     largest accepted request body in bytes (default: 64 MiB)\n"
+         << "  --cache N        word cache slots shared by the workers (default: 65536,\n"
+         << "                   0 turns it off)\n"
+         << "  --max-edits N    typos tolerated in unknown words, 0-2 (default: 2)\n"
+         << "  --no-ngrams      do not guess unknown words from their letter n-grams\n"
+         << "  --report N       print the /stats line on stderr every N seconds\n"
+         << "  -h, --help       show this help\n";
+}
+
+struct ServerOptions {
+    string socketPath;
+    int port = -1;
+    string dictDir;
+    string imagePath;
+    size_t threads = 0;
+    size_t maxBatch = 64;
+    size_t maxBody = 64 << 20;
+    size_t cacheSlots = 1 << 16;
+    bool useNgrams = true;
+    unsigned reportSeconds = 0;
+    DetectionOptions detection;
+};
+
+namespace {
+
+// One parsed request waiting for, or going through, detection
+struct Job {
+    uint64_t connection;
+    uint64_t sequence;          // position among the connection's requests
+    string text;
+    bool includeMatrix;
+    Clock::time_point received;
+};
+
+struct Completion {
+    uint64_t connection;
+    uint64_t sequence;
+    string response;
+    double latencyMicros;
+};
+
+struct Connection {
+    int fd = -1;
+    string input;
+    string output;
+    uint64_t nextSequence = 0;          // assigned to the next request read
+    uint64_t nextToSend = 0;            // responses go out in request order
+    map<uint64_t, string> ready;        // finished out of order
+    bool closeWhenDone = false;
+    bool readClosed = false;            // the client shut down its side
+    bool writing = false;               // EPOLLOUT registered
+    bool closing = false;               // closed at the end of the round
+};
+
+// Latencies of the most recent requests, for percentiles
+class LatencyWindow {
+public:
+    void add(double micros) {
+        if (samples.size() < CAPACITY) {
+            samples.push_back(micros);
+        } else {
+            samples[next] = micros;
+        }
+        next = (next + 1) % CAPACITY;
+        total += micros;
+        ++count;
+        maximum = max(maximum, micros);
+    }
+
+    void writeJson(ostream& out) const {
+        vector<double> sorted(samples);
+        sort(sorted.begin(), sorted.end());
+        auto percentile = [&](double p) {
+            return sorted.empty() ? 0.0 : sorted[static_cast<size_t>(p * (sorted.size() - 1))];
+        };
+        out << "{\"mean\":" << (count ? total / count : 0.0)
+            << ",\"p50\":" << percentile(0.50)
+            << ",\"p90\":" << percentile(0.90)
+            << ",\"p99\":" << percentile(0.99)
+            << ",\"max\":" << maximum << "}";
+    }
+
+private:
+    static const size_t CAPACITY = 8192;
+    vector<double> samples;
+    size_t next = 0;
+    uint64_t count = 0;
+    double total = 0.0;
+    double maximum = 0.0;
+};
+
+string httpResponse(int status, const char* reason, const string& body, bool close,
+                    const string& extraHeaders = "") {
+    ostringstream out;
+    out << "HTTP/1.1 " << status << " " << reason << "\r\n"
+        << "Content-Type: application/json\r\n"
+        << "Content-Length: " << body.size() << "\r\n"
+        << extraHeaders;
+    if (close) out << "Connection: close\r\n";
+    out << "\r\n" << body;
+    return out.str();
+}
+
+string errorBody(const string& message) {
+    return "{\"error\":\"" + jsonEscape(message) + "\"}\n";
+}
+
+// epoll tags for the fixed descriptors; connections are numbered after them
+const uint64_t TAG_WAKE = 0;
+const uint64_t TAG_SIGNAL = 1;
+const uint64_t TAG_UNIX = 2;
+const uint64_t TAG_TCP = 3;
+const uint64_t FIRST_CONNECTION = 16;
+
+class Server {
+public:
+    Server(const DictionaryImage& dictionary, const ServerOptions& options)
+        : dictionary(dictionary), options(options) {}
+
+    ~Server() {
+        for (auto& entry : connections) close(entry.second.fd);
+        if (unixFd >= 0) {
+            close(unixFd);
+            unlink(options.socketPath.c_str());
+        }
+        if (tcpFd >= 0) close(tcpFd);
+        if (wakeFd >= 0) close(wakeFd);
+        if (signalFd >= 0) close(signalFd);
+        if (epollFd >= 0) close(epollFd);
+    }
+
+    // Opens the listening sockets; the pool is started by the caller after
+    // signals are blocked, so workers never receive them
+    bool open(const sigset_t& signals) {
+        epollFd = epoll_create1(EPOLL_CLOEXEC);
+        wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        signalFd = signalfd(-1, &signals, SFD_NONBLOCK | SFD_CLOEXEC);
+        if (epollFd < 0 || wakeFd < 0 || signalFd < 0) return fail("epoll setup");
+        watch(wakeFd, TAG_WAKE, EPOLLIN);
+        watch(signalFd, TAG_SIGNAL, EPOLLIN);
+
+        if (!options.socketPath.empty()) {
+            sockaddr_un address = {};
+            address.sun_family = AF_UNIX;
+            if (options.socketPath.size() >= sizeof(address.sun_path)) {
+                cerr << "Error: Socket path too long: " << options.socketPath << "\n";
+                return false;
+            }
+            strcpy(address.sun_path, options.socketPath.c_str());
+            unlink(options.socketPath.c_str());   // left behind by a previous run
+            unixFd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+            if (unixFd < 0 || bind(unixFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 ||
+                listen(unixFd, SOMAXCONN) < 0) {
+                return fail("listen on " + options.socketPath);
+            }
+            watch(unixFd, TAG_UNIX, EPOLLIN);
+            cerr << "Listening on unix:" << options.socketPath << "\n";
+        }
+        if (options.port >= 0) {
+            sockaddr_in address = {};
+            address.sin_family = AF_INET;
+            address.sin_port = htons(static_cast<uint16_t>(options.port));
+            address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            int reuse = 1;
+            tcpFd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+            if (tcpFd < 0 || setsockopt(tcpFd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse)) < 0 ||
+                bind(tcpFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 ||
+                listen(tcpFd, SOMAXCONN) < 0) {
+                return fail("listen on 127.0.0.1:" + to_string(options.port));
+            }
+            watch(tcpFd, TAG_TCP, EPOLLIN);
+            cerr << "Listening on http://127.0.0.1:" << options.port << "\n";
+        }
+        return true;
+    }
+
+    // Serves until SIGINT or SIGTERM, then answers every request already
+    // read before returning
+    void run(ThreadPool& workers) {
+        pool = &workers;
+        Clock::time_point lastReport = Clock::now();
+        int timeout = options.reportSeconds ? 1000 : -1;
+        epoll_event events[64];
+
+        while (!stopping) {
+            int count = epoll_wait(epollFd, events, 64, timeout);
+            if (count < 0 && errno != EINTR) {
+                perror("epoll_wait");
+                break;
+            }
+            for (int i = 0; i < count; ++i) handle(events[i]);
+
+            // Everything read in this round is dispatched together
+            dispatch();
+            closeMarked();
+
+            if (options.reportSeconds &&
+                Clock::now() - lastReport >= chrono::seconds(options.reportSeconds)) {
+                lastReport = Clock::now();
+                cerr << statsJson();
+            }
+        }
+        // No more input is read; finish the batches in flight and the
+        // requests still waiting for a worker, then send what is left
+        do {
+            pool->wait();
+            collectCompletions();
+            dispatch();
+        } while (busyWorkers);
+        closeMarked();
+        drainOutput();
+        cerr << "Stopped after " << requests << " requests\n";
+    }
+
+private:
+    bool fail(const string& what) {
+        cerr << "Error: Could not " << what << ": " << strerror(errno) << "\n";
+        return false;
+    }
+
+    void watch(int fd, uint64_t tag, uint32_t events) {
+        epoll_event event = {};
+        event.events = events;
+        event.data.u64 = tag;
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event);
+    }
+
+    void handle(const epoll_event& event) {
+        uint64_t tag = event.data.u64;
+        if (tag == TAG_WAKE) {
+            uint64_t ignored;
+            while (read(wakeFd, &ignored, sizeof(ignored)) > 0) {}
+            collectCompletions();
+        } else if (tag == TAG_SIGNAL) {
+            signalfd_siginfo info;
+            while (read(signalFd, &info, sizeof(info)) > 0) stopping = true;
+        } else if (tag == TAG_UNIX || tag == TAG_TCP) {
+            acceptAll(tag == TAG_UNIX ? unixFd : tcpFd);
+        } else {
+            auto it = connections.find(tag);
+            if (it == connections.end() || it->second.closing) return;
+            Connection& connection = it->second;
+            if (event.events & EPOLLERR) {
+                markClosing(tag, connection);
+                return;
+            }
+            if (event.events & EPOLLIN) readFrom(tag, connection);
+            if ((event.events & EPOLLOUT) && !connection.closing) flush(tag, connection);
+        }
+    }
+
+    void acceptAll(int listenFd) {
+        for (;;) {
+            int fd = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd < 0) return;
+            uint64_t id = nextConnection++;
+            connections[id].fd = fd;
+            watch(fd, id, EPOLLIN | EPOLLRDHUP);
+        }
+    }
+
+    // Reads what is available and queues every complete request
+    void readFrom(uint64_t id, Connection& connection) {
+        char buffer[64 * 1024];
+        for (;;) {
+            ssize_t got = recv(connection.fd, buffer, sizeof(buffer), 0);
+            if (got > 0) {
+                connection.input.append(buffer, static_cast<size_t>(got));
+                continue;
+            }
+            if (got == 0) {
+                connection.readClosed = true;
+                break;
+            }
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+            markClosing(id, connection);
+            return;
+        }
+        while (!connection.closeWhenDone && !connection.closing && parseRequest(id, connection)) {}
+
+        // A client that half-closed after its requests still gets the answers
+        if (connection.readClosed && !connection.closing) {
+            connection.closeWhenDone = true;
+            flush(id, connection);
+        }
+    }
+
+    // Takes one complete request off the front of the input. Returns false
+    // when more bytes are needed (or the connection is being closed).
+    bool parseRequest(uint64_t id, Connection& connection) {
+        size_t headerEnd = connection.input.find("\r\n\r\n");
+        if (headerEnd == string::npos) {
+            if (connection.input.size() > MAX_HEADER) reject(id, connection, 431, "Request Header Fields Too Large");
+            return false;
+        }
+
+        istringstream head(connection.input.substr(0, headerEnd));
+        string method, target, version, line;
+        head >> method >> target >> version;
+        getline(head, line);
+        size_t contentLength = 0;
+        bool close = (version == "HTTP/1.0");
+        while (getline(head, line)) {
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            size_t colon = line.find(':');
+            if (colon == string::npos) continue;
+            string name = line.substr(0, colon);
+            string value = line.substr(colon + 1);
+            value.erase(0, value.find_first_not_of(' '));
+            auto lower = [](unsigned char c) { return static_cast<char>(tolower(c)); };
+            transform(name.begin(), name.end(), name.begin(), lower);
+            transform(value.begin(), value.end(), value.begin(), lower);
+            if (name == "content-length") contentLength = strtoull(value.c_str(), nullptr, 10);
+            if (name == "connection") close = (value == "close") || (close && value != "keep-alive");
+            if (name == "transfer-encoding" && value != "identity") {
+                reject(id, connection, 501, "Not Implemented");
+                return false;
+            }
+        }
+        if (contentLength > options.maxBody) {
+            reject(id, connection, 413, "Payload Too Large");
+            return false;
+        }
+        size_t bodyStart = headerEnd + 4;
+        if (connection.input.size() - bodyStart < contentLength) return false;
+
+        string body = connection.input.substr(bodyStart, contentLength);
+        connection.input.erase(0, bodyStart + contentLength);
+        connection.closeWhenDone = close;
+        uint64_t sequence = connection.nextSequence++;
+
+        string path = target.substr(0, target.find('?'));
+        string query = target.size() > path.size() ? target.substr(path.size() + 1) : "";
+        if (path == "/detect" && method == "POST") {
+            Job job;
+            job.connection = id;
+            job.sequence = sequence;
+            job.text = move(body);
+            job.includeMatrix = query.find("matrix=1") != string::npos;
+            job.received = Clock::now();
+            pending.push_back(move(job));
+        } else if (path == "/stats" && method == "GET") {
+            respond(id, connection, sequence, httpResponse(200, "OK", statsJson(), close));
+        } else if (path == "/detect" || path == "/stats") {
+            respond(id, connection, sequence, httpResponse(405, "Method Not Allowed", errorBody("wrong method"), close));
+        } else {
+            respond(id, connection, sequence, httpResponse(404, "Not Found", errorBody("unknown path"), close));
+        }
+        return true;
+    }
+
+    void reject(uint64_t id, Connection& connection, int status, const char* reason) {
+        connection.closeWhenDone = true;
+        connection.input.clear();
+        respond(id, connection, connection.nextSequence++, httpResponse(status, reason, errorBody(reason), true));
+    }
+
+    // Hands pending requests to idle workers. While every worker is busy
+    // requests pile up, and the next worker to free up takes up to
+    // --max-batch of them at once; when workers are idle the requests are
+    // spread over them instead.
+    void dispatch() {
+        while (!pending.empty() && busyWorkers < pool->threadCount()) {
+            size_t idle = pool->threadCount() - busyWorkers;
+            size_t size = min(options.maxBatch, (pending.size() + idle - 1) / idle);
+            auto batch = make_shared<vector<Job>>(make_move_iterator(pending.begin()),
+                                                  make_move_iterator(pending.begin() + size));
+            pending.erase(pending.begin(), pending.begin() + size);
+            ++busyWorkers;
+            inFlight += size;
+            ++batches;
+            batchedRequests += size;
+            pool->submit([this, batch] { detectBatch(*batch); });
+        }
+    }
+
+    // Runs on a worker thread
+    void detectBatch(vector<Job>& batch) {
+        vector<Completion> done;
+        done.reserve(batch.size());
+        for (Job& job : batch) {
+            DetectionResult result = detectLanguageWithMatrix(job.text, dictionary, options.detection);
+            ostringstream body;
+            writeResultJson(body, result, job.includeMatrix);
+            body << "\n";
+
+            Completion completion;
+            completion.connection = job.connection;
+            completion.sequence = job.sequence;
+            completion.latencyMicros = chrono::duration<double, micro>(Clock::now() - job.received).count();
+            ostringstream headers;
+            headers << "X-Latency-Us: " << static_cast<uint64_t>(completion.latencyMicros) << "\r\n"
+                    << "X-Batch-Size: " << batch.size() << "\r\n";
+            completion.response = httpResponse(200, "OK", body.str(), false, headers.str());
+            done.push_back(move(completion));
+        }
+        {
+            lock_guard<mutex> lock(completionMutex);
+            for (Completion& completion : done) completions.push_back(move(completion));
+            ++finishedBatches;
+        }
+        uint64_t one = 1;
+        ssize_t written = write(wakeFd, &one, sizeof(one));
+        (void)written;
+    }
+
+    void collectCompletions() {
+        vector<Completion> done;
+        size_t finished;
+        {
+            lock_guard<mutex> lock(completionMutex);
+            done.swap(completions);
+            finished = finishedBatches;
+            finishedBatches = 0;
+        }
+        busyWorkers -= finished;
+        inFlight -= done.size();
+        for (Completion& completion : done) {
+            latencies.add(completion.latencyMicros);
+            ++requests;
+            auto it = connections.find(completion.connection);
+            if (it == connections.end() || it->second.closing) continue;   // client went away
+            respond(completion.connection, it->second, completion.sequence, move(completion.response));
+        }
+    }
+
+    // Queues a response and sends every response that is now in order
+    void respond(uint64_t id, Connection& connection, uint64_t sequence, string response) {
+        connection.ready.emplace(sequence, move(response));
+        for (auto it = connection.ready.begin();
+             it != connection.ready.end() && it->first == connection.nextToSend;
+             it = connection.ready.erase(it)) {
+            connection.output += it->second;
+            ++connection.nextToSend;
+        }
+        flush(id, connection);
+    }
+
+    // Sends what the socket takes. Never closes the connection itself, since
+    // callers still hold it: a finished or failed one is only marked.
+    void flush(uint64_t id, Connection& connection) {
+        if (connection.closing) return;
+        while (!connection.output.empty()) {
+            ssize_t sent = send(connection.fd, connection.output.data(), connection.output.size(), MSG_NOSIGNAL);
+            if (sent < 0) {
+                if (errno == EINTR) continue;
+                if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+                markClosing(id, connection);
+                return;
+            }
+            connection.output.erase(0, static_cast<size_t>(sent));
+        }
+
+        bool wantWrite = !connection.output.empty();
+        bool wantRead = !connection.readClosed && !stopping;
+        if (wantWrite != connection.writing || !wantRead) {
+            // Stop polling for input once the client has closed its side, or
+            // the end-of-file would be reported forever, and on shutdown
+            epoll_event event = {};
+            if (wantRead) event.events |= EPOLLIN | EPOLLRDHUP;
+            if (wantWrite) event.events |= EPOLLOUT;
+            event.data.u64 = id;
+            epoll_ctl(epollFd, EPOLL_CTL_MOD, connection.fd, &event);
+            connection.writing = wantWrite;
+        }
+        if (!wantWrite && connection.closeWhenDone && connection.nextToSend == connection.nextSequence) {
+            markClosing(id, connection);
+        }
+    }
+
+    void markClosing(uint64_t id, Connection& connection) {
+        if (connection.closing) return;
+        connection.closing = true;
+        closingIds.push_back(id);
+    }
+
+    // Closes the connections marked during the round, once nothing refers
+    // to them any more
+    void closeMarked() {
+        for (uint64_t id : closingIds) closeConnection(id);
+        closingIds.clear();
+    }
+
+    // On shutdown: waits, at most SHUTDOWN_GRACE, for the clients to take
+    // the responses the sockets could not hold yet
+    void drainOutput() {
+        for (auto& entry : connections) flush(entry.first, entry.second);
+        closeMarked();
+        Clock::time_point deadline = Clock::now() + SHUTDOWN_GRACE;
+        epoll_event events[64];
+        for (;;) {
+            bool waiting = false;
+            for (auto& entry : connections) waiting = waiting || !entry.second.output.empty();
+            Clock::time_point now = Clock::now();
+            if (!waiting || now >= deadline) return;
+
+            auto left = chrono::duration_cast<chrono::milliseconds>(deadline - now).count();
+            int count = epoll_wait(epollFd, events, 64, static_cast<int>(left) + 1);
+            if (count < 0 && errno != EINTR) return;
+            for (int i = 0; i < count; ++i) {
+                auto it = connections.find(events[i].data.u64);
+                if (it == connections.end() || it->second.closing) continue;
+                if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+                    markClosing(it->first, it->second);
+                } else if (events[i].events & EPOLLOUT) {
+                    flush(it->first, it->second);
+                }
+            }
+            closeMarked();
+        }
+    }
+
+    void closeConnection(uint64_t id) {
+        auto it = connections.find(id);
+        if (it == connections.end()) return;
+        close(it->second.fd);   // also removes it from the epoll set
+        connections.erase(it);
+    }
+
+    string statsJson() {
+        ostringstream out;
+        out << "{\"queue_depth\":" << pending.size() + inFlight
+            << ",\"pending\":" << pending.size()
+            << ",\"in_flight\":" << inFlight
+            << ",\"busy_workers\":" << busyWorkers
+            << ",\"workers\":" << (pool ? pool->threadCount() : 0)
+            << ",\"connections\":" << connections.size()
+            << ",\"requests\":" << requests
+            << ",\"batches\":" << batches
+            << ",\"mean_batch_size\":" << (batches ? static_cast<double>(batchedRequests) / batches : 0.0)
+            << ",\"latency_us\":";
+        latencies.writeJson(out);
+        out << "}\n";
+        return out.str();
+    }
+
+    static const size_t MAX_HEADER = 64 * 1024;
+    static constexpr chrono::seconds SHUTDOWN_GRACE{5};
+
+    const DictionaryImage& dictionary;
+    const ServerOptions& options;
+    ThreadPool* pool = nullptr;
+
+    int epollFd = -1;
+    int wakeFd = -1;
+    int signalFd = -1;
+    int unixFd = -1;
+    int tcpFd = -1;
+    bool stopping = false;
+
+    unordered_map<uint64_t, Connection> connections;
+    uint64_t nextConnection = FIRST_CONNECTION;
+    vector<uint64_t> closingIds;  // marked this round, see closeMarked()
+
+    vector<Job> pending;          // parsed, not yet handed to a worker
+    size_t busyWorkers = 0;
+    size_t inFlight = 0;          // requests inside dispatched batches
+
+    mutex completionMutex;        // guards the two fields below
+    vector<Completion> completions;
+    size_t finishedBatches = 0;
+
+    uint64_t requests = 0;
+    uint64_t batches = 0;
+    uint64_t batchedRequests = 0;
+    LatencyWindow latencies;
+};
+
+} // namespace
+
+int main(int argc, char** argv) {
+    ServerOptions options;
+    options.detection.recordContributors = false;  // responses never list words
+
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "-h" || arg == "--help") {
+            printUsage(argv[0]);
+            return 0;
+        } else if (arg == "--socket" && i + 1 < argc) {
+            options.socketPath = argv[++i];
+        } else if (arg == "--port" && i + 1 < argc) {
+            options.port = static_cast<int>(strtol(argv[++i], nullptr, 10));
+        } else if (arg == "--dict-dir" && i + 1 < argc) {
+            options.dictDir = argv[++i];
+        } else if (arg == "--dictionary" && i + 1 < argc) {
+            options.imagePath = argv[++i];
+        } else if (arg == "--threads" && i + 1 < argc) {
+            options.threads = static_cast<size_t>(strtoul(argv[++i], nullptr, 10));
+        } else if (arg == "--max-batch" && i + 1 < argc) {
+            options.maxBatch = max<size_t>(1, strtoul(argv[++i], nullptr, 10));
+        } else if (arg == "--max-body" && i + 1 < argc) {
+            options.maxBody = static_cast<size_t>(strtoull(argv[++i], nullptr, 10));
+        } else if (arg == "--cache" && i + 1 < argc) {
+            options.cacheSlots = static_cast<size_t>(strtoul(argv[++i], nullptr, 10));
+        } else if (arg == "--max-edits" && i + 1 < argc) {
+            options.detection.maxEditDistance = static_cast<unsigned>(strtoul(argv[++i], nullptr, 10));
+        } else if (arg == "--no-ngrams") {
+            options.useNgrams = false;
+        } else if (arg == "--report" && i + 1 < argc) {
+            options.reportSeconds = static_cast<unsigned>(strtoul(argv[++i], nullptr, 10));
+        } else {
+            cerr << "Error: Unknown option " << arg << "\n";
+            printUsage(argv[0]);
+            return 2;
+        }
+    }
+    if (options.socketPath.empty() && options.port < 0) options.socketPath = "/tmp/langwitch.sock";
+
+    DictionaryImage dictionary;
+    string overrideDir;
+    if (!options.imagePath.empty()) {
+        if (!dictionary.openFile(options.imagePath)) return 1;
+    } else if (options.dictDir.empty()) {
+        if (!loadDefaultDictionary(&dictionary, argv[0], &overrideDir)) return 1;
+    } else if (!buildDictionary(&dictionary, options.dictDir)) {
+        cerr << "Error: Could not load dictionaries from " << options.dictDir << "\n";
+        return 1;
+    }
+
+    NgramProfile ngrams;
+    if (options.useNgrams && ngrams.build(dictionary)) options.detection.ngrams = &ngrams;
+
+    unique_ptr<WordCache> cache;
+    if (options.cacheSlots) {
+        cache.reset(new WordCache(options.cacheSlots));
+        options.detection.cache = cache.get();
+    }
+
+    // Blocked before the workers start so only the signalfd sees them
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+    Server server(dictionary, options);
+    if (!server.open(signals)) return 1;
+
+    ThreadPool pool(options.threads);
+    server.run(pool);
+    return 0;
+}
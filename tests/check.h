@@ -0,0 +1,65 @@
+#ifndef CHECK_H
+#define CHECK_H
+
+#include <iostream>
+#include <string>
+#include <string_view>
+
+// Minimal assertions for the test executables: a failed check prints where
+// and what, and the test returns checkResult() so CTest sees the failure.
+namespace check_detail {
+
+inline int& failures() {
+    static int count = 0;
+    return count;
+}
+
+// Bytes >= 0x80 and control characters as \xNN, so mismatches in malformed
+// UTF-8 are readable
+inline std::string escape(std::string_view bytes) {
+    static const char digits[] = "0123456789ABCDEF";
+    std::string out;
+    for (char ch : bytes) {
+        unsigned char c = static_cast<unsigned char>(ch);
+        if (c >= 0x20 && c < 0x7F && c != '\\') {
+            out += ch;
+        } else {
+            out += "\\x";
+            out += digits[c >> 4];
+            out += digits[c & 0xF];
+        }
+    }
+    return out;
+}
+
+inline void fail(const char* file, int line, const std::string& message) {
+    ++failures();
+    std::cerr << file << ":" << line << ": " << message << "\n";
+}
+
+} // namespace check_detail
+
+#define CHECK(condition)                                                              \
+    do {                                                                              \
+        if (!(condition)) check_detail::fail(__FILE__, __LINE__, "failed: " #condition); \
+    } while (0)
+
+// Compares two byte strings, reporting both escaped on a mismatch. The
+// arguments are copied, so temporaries are fine.
+#define CHECK_BYTES(actual, expected, context)                                                   \
+    do {                                                                                         \
+        std::string checkActual(actual), checkExpected(expected);                                \
+        if (checkActual != checkExpected) {                                                      \
+            check_detail::fail(__FILE__, __LINE__,                                               \
+                               std::string(context) + ": got \"" + check_detail::escape(checkActual) + \
+                                   "\", expected \"" + check_detail::escape(checkExpected) + "\""); \
+        }                                                                                        \
+    } while (0)
+
+inline int checkResult(const char* test) {
+    int failed = check_detail::failures();
+    if (failed) std::cerr << test << ": " << failed << " check(s) failed\n";
+    return failed ? 1 : 0;
+}
+
+#endif
@@ -0,0 +1,92 @@
+#include "check.h"
+#include "language_detector.h"
+#include "test_dictionary.h"
+#include <string>
+
+using namespace std;
+
+static bool buildDictionary(DictionaryImage* image, bool frenchFirst) {
+    TestLanguage english{"English", {"hello", "world", "house"}};
+    TestLanguage french{"French", {"bonjour", "monde", "maison"}};
+    return frenchFirst ? buildTestDictionary(image, {french, english}) : buildTestDictionary(image, {english, french});
+}
+
+// Equal evidence goes to the language registered first, whatever the word
+// order
+static void testTieBreak() {
+    for (bool frenchFirst : {false, true}) {
+        DictionaryImage dictionary;
+        CHECK(buildDictionary(&dictionary, frenchFirst));
+        string first = frenchFirst ? "French" : "English";
+        CHECK(detectLanguageWithMatrix("hello bonjour", dictionary).language == first);
+        CHECK(detectLanguageWithMatrix("bonjour hello", dictionary).language == first);
+        CHECK(detectLanguageWithMatrix("maison house world monde", dictionary).language == first);
+    }
+}
+
+// One typo counts half, two a quarter
+static void testTypoWeights() {
+    DictionaryImage dictionary;
+    CHECK(buildDictionary(&dictionary, false));
+    size_t french = 1;
+
+    DetectionResult result = detectLanguageWithMatrix("maisonn", dictionary);
+    CHECK(result.language == "French");
+    CHECK(result.at(french, french) == 0.5);
+    CHECK(result.evidence == 0.5);
+
+    result = detectLanguageWithMatrix("maisonxx", dictionary);
+    CHECK(result.at(french, french) == 0.25);
+    CHECK(result.evidence == 0.25);
+
+    // An exact word outweighs two typos of the other language
+    CHECK(detectLanguageWithMatrix("housee bonjourr monde", dictionary).language == "French");
+    CHECK(detectLanguageWithMatrix("helo worlld maison", dictionary).language == "English");
+}
+
+// The closest words other than the key itself, with their exact distance
+static void testFuzzyLookup() {
+    DictionaryImage dictionary;
+    CHECK(buildTestDictionary(&dictionary, {{"English", {"hello", "house"}}, {"French", {"hallo", "maison"}}}));
+    unsigned distance = 9;
+    CHECK(dictionary.fuzzyLookup("hello", 2, &distance) == 2);   // "hallo", not the key
+    CHECK(distance == 1);
+    CHECK(dictionary.fuzzyLookup("hexlo", 2, &distance) == 1);
+    CHECK(distance == 1);
+    CHECK(dictionary.fuzzyLookup("hexxo", 2, &distance) == 1);
+    CHECK(distance == 2);
+    CHECK(dictionary.fuzzyLookup("maison", 2, &distance) == 0);
+    CHECK(distance == 0);
+    CHECK(dictionary.fuzzyLookup("xouse", 2, &distance) == 0);   // the first letter must match
+}
+
+// Feeding the input in pieces gives the result of feeding it whole
+static void testChunkedFeed() {
+    DictionaryImage dictionary;
+    CHECK(buildDictionary(&dictionary, false));
+    string text = "hello world, le monde et la maison; helo " + string(300, 'x') + " house";
+    DetectionResult whole = detectLanguageWithMatrix(text, dictionary);
+    CHECK(whole.tokensConsumed == 9);   // the run of x is no word
+
+    for (size_t step : {1, 3, 64}) {
+        StreamingDetector detector(dictionary);
+        for (size_t from = 0; from < text.size(); from += step) detector.feed(string_view(text).substr(from, step));
+        DetectionResult pieces = detector.finish();
+        CHECK(pieces.language == whole.language);
+        CHECK(pieces.matrix == whole.matrix);
+        CHECK(pieces.tokensConsumed == whole.tokensConsumed);
+        CHECK(pieces.contributorSpans.size() == whole.contributorSpans.size());
+        for (size_t i = 0; i < pieces.contributorSpans.size() && i < whole.contributorSpans.size(); ++i) {
+            CHECK(pieces.contributorSpans[i].offset == whole.contributorSpans[i].offset);
+            CHECK(pieces.contributorSpans[i].length == whole.contributorSpans[i].length);
+        }
+    }
+}
+
+int main() {
+    testTieBreak();
+    testTypoWeights();
+    testFuzzyLookup();
+    testChunkedFeed();
+    return checkResult("detector_test");
+}
@@ -0,0 +1,109 @@
+#include "check.h"
+#include "file_detector.h"
+#include "test_dictionary.h"
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+
+using namespace std;
+namespace fs = std::filesystem;
+
+// A file in the temporary directory, removed again by the destructor
+class TempFile {
+public:
+    explicit TempFile(const string& contents) {
+        path = (fs::temp_directory_path() / ("langwitch-test-" + to_string(random_device()()) + ".txt")).string();
+        ofstream file(path, ios::binary);
+        file << contents;
+    }
+    ~TempFile() { remove(path.c_str()); }
+
+    string path;
+};
+
+static void checkPreview(const string& contents, size_t limit, const string& expected, bool expectTruncated,
+                         const string& context) {
+    TempFile file(contents);
+    string preview = "stale";
+    bool truncated = !expectTruncated;
+    CHECK(readFilePreview(file.path, limit, &preview, &truncated));
+    CHECK_BYTES(preview, expected, context);
+    if (truncated != expectTruncated) check_detail::fail(__FILE__, __LINE__, context + ": truncated is wrong");
+}
+
+static void testPreview() {
+    // Cut at the last line break before the limit
+    checkPreview("line one\nline two\nline three", 15, "line one\n", true, "cut after a line");
+    checkPreview("line one\nline two\nline three", 18, "line one\nline two\n", true, "limit just past a break");
+    checkPreview("line one\nline two\nline three", 17, "line one\n", true, "limit at a break");
+
+    // Without a line break, never end inside a character
+    checkPreview("ab\xC3\xA9" "cd", 3, "ab", true, "inside a 2-byte character");
+    checkPreview("ab\xC3\xA9" "cd", 4, "ab\xC3\xA9", true, "after a 2-byte character");
+    for (size_t limit = 2; limit <= 3; ++limit) {
+        checkPreview("a\xE2\x82\xAC" "b", limit, "a", true, "inside a 3-byte character at " + to_string(limit));
+    }
+    checkPreview("a\xE2\x82\xAC" "b", 4, "a\xE2\x82\xAC", true, "after a 3-byte character");
+    for (size_t limit = 2; limit <= 4; ++limit) {
+        checkPreview("a\xF0\x9F\x98\x80" "b", limit, "a", true, "inside a 4-byte character at " + to_string(limit));
+    }
+    checkPreview("a\xF0\x9F\x98\x80" "b", 5, "a\xF0\x9F\x98\x80", true, "after a 4-byte character");
+    checkPreview("\xE2\x82\xAC\xE2\x82\xAC", 1, "", true, "only part of the first character");
+
+    // A file within the limit is read whole
+    checkPreview("short\ntext", 100, "short\ntext", false, "shorter than the limit");
+    checkPreview("exactly10!", 10, "exactly10!", false, "exactly the limit");
+    checkPreview("", 10, "", false, "empty file");
+
+    string preview;
+    bool truncated = false;
+    CHECK(!readFilePreview((fs::temp_directory_path() / "langwitch-test-missing.txt").string(), 10, &preview,
+                           &truncated));
+}
+
+// A file of several chunks, with words across the chunk boundaries, is
+// detected as if it were read whole
+static void testDetectFile() {
+    DictionaryImage dictionary;
+    CHECK(buildTestDictionary(&dictionary, {{"English", {"hello", "world", "house", "garden"}},
+                                            {"French", {"bonjour", "monde", "maison", "jardin"}}}));
+    static const char* const words[] = {"hello", "world", "house", "garden", "bonjour", "monde",
+                                        "maison", "jardin", "xyzzy", "helo", "jardiin", "1234"};
+    mt19937 random(7);
+    string text;
+    while (text.size() < 2 * FILE_CHUNK_BYTES + FILE_CHUNK_BYTES / 2) {
+        text += words[random() % (sizeof(words) / sizeof(words[0]))];
+        text += random() % 8 ? " " : ".\n";
+    }
+    TempFile file(text);
+
+    DetectionResult fromFile;
+    size_t reports = 0, lastDone = 0;
+    bool ordered = true;
+    CHECK(detectFile(file.path, dictionary, DetectionOptions(), &fromFile, [&](size_t done, size_t total) {
+        ordered = ordered && done > lastDone && total == text.size();
+        lastDone = done;
+        ++reports;
+    }));
+    CHECK(ordered);
+    CHECK(reports == 3);
+    CHECK(lastDone == text.size());
+
+    DetectionResult whole = detectLanguageWithMatrix(text, dictionary);
+    CHECK(fromFile.language == whole.language);
+    CHECK(fromFile.matrix == whole.matrix);
+    CHECK(fromFile.evidence == whole.evidence);
+    CHECK(fromFile.tokensConsumed == whole.tokensConsumed);
+    CHECK(fromFile.contributorSpans.empty());
+
+    CHECK(!detectFile((fs::temp_directory_path() / "langwitch-test-missing.txt").string(), dictionary,
+                      DetectionOptions(), &fromFile));
+}
+
+int main() {
+    testPreview();
+    testDetectFile();
+    return checkResult("file_detector_test");
+}
@@ -0,0 +1,61 @@
+#include "check.h"
+#include "language_detector.h"
+#include "test_dictionary.h"
+#include <atomic>
+#include <string>
+
+using namespace std;
+
+static bool buildSmallDictionary(DictionaryImage* image) {
+    return buildTestDictionary(image, {{"English", {"hello", "world", "the", "house"}},
+                                       {"French", {"bonjour", "monde", "le", "maison"}}});
+}
+
+static void testReusesLines() {
+    DictionaryImage dictionary;
+    CHECK(buildSmallDictionary(&dictionary));
+    IncrementalDetector detector(dictionary);
+
+    DetectionResult result;
+    CHECK(detector.update("hello world\nthe house\nle monde", &result));
+    CHECK(detector.linesDetected() == 3);
+    CHECK(result.language == "English");
+
+    // Only the edited line is detected again
+    CHECK(detector.update("hello world\nthe house\nle monde maison", &result));
+    CHECK(detector.linesDetected() == 1);
+    CHECK(result.language == "English");
+    CHECK(result.tokensConsumed == 7);
+}
+
+// A cancelled update must leave the lines it reused, and those it
+// finished, for the next one
+static void testCancelKeepsLines() {
+    DictionaryImage dictionary;
+    CHECK(buildSmallDictionary(&dictionary));
+    IncrementalDetector detector(dictionary);
+
+    DetectionResult result;
+    CHECK(detector.update("hello world\nthe house\nle monde", &result));
+
+    atomic<bool> cancel{true};
+    CHECK(!detector.update("hello world\nthe house\nle monde\nbonjour", &result, &cancel));
+    CHECK(!detector.update("hello world\nthe house\nbonjour le monde", &result, &cancel));
+
+    CHECK(detector.update("hello world\nthe house\nle monde\nbonjour", &result));
+    CHECK(detector.linesDetected() == 1);
+    CHECK(result.tokensConsumed == 7);
+
+    // Lines only the cancelled updates saw are dropped by the next
+    // completed one
+    CHECK(detector.update("hello world", &result));
+    CHECK(detector.linesDetected() == 0);
+    CHECK(detector.update("the house", &result));
+    CHECK(detector.linesDetected() == 1);
+}
+
+int main() {
+    testReusesLines();
+    testCancelKeepsLines();
+    return checkResult("incremental_test");
+}
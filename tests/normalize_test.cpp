@@ -0,0 +1,182 @@
+#include "check.h"
+#include "normalize.h"
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace normalize_detail;
+
+// One character at a time through the UTF-8 DFA, without the SSE2, eight
+// byte and two-byte shortcuts normalizeWordInto() takes
+static string referenceNormalize(string_view word) {
+    string out;
+    for (size_t i = 0; i < word.size();) {
+        uint32_t codepoint;
+        size_t taken = decodeUtf8(word.data(), word.size(), i, codepoint);
+        if (codepoint < 0x80) {
+            if (asciiFold.fold[codepoint]) out += static_cast<char>(asciiFold.fold[codepoint]);
+        } else {
+            char folded[4];
+            out.append(folded, foldCodepoint(codepoint, folded));
+        }
+        i += taken;
+    }
+    return out;
+}
+
+// Normalizes from a buffer of exactly the word's size, so reading past the
+// end shows up under a sanitizer
+static string normalizeExact(string_view word) {
+    vector<char> input(word.begin(), word.end());
+    vector<char> output(word.size() + 1, '\x7F');
+    size_t written = normalizeWordInto(input.data(), input.size(), output.data());
+    CHECK(written <= word.size());
+    CHECK(output[word.size()] == '\x7F');   // nothing written past the room given
+    return string(output.data(), written);
+}
+
+static void checkNormalizes(string_view word, string_view expected) {
+    CHECK_BYTES(normalizeExact(word), expected, "normalize \"" + check_detail::escape(word) + "\"");
+    CHECK_BYTES(normalizeWord(word), expected, "normalizeWord \"" + check_detail::escape(word) + "\"");
+}
+
+static void testKnownWords() {
+    checkNormalizes("", "");
+    checkNormalizes("hello", "hello");
+    checkNormalizes("HeLLo", "hello");
+    checkNormalizes("aujourd'hui", "aujourdhui");
+    checkNormalizes("Etats-Unis", "etatsunis");
+    checkNormalizes("abc123def", "abcdef");
+    checkNormalizes("@[`{", "");   // the bytes either side of A-Z and a-z
+    checkNormalizes("Éléphant", "elephant");
+    checkNormalizes("Straße", "strasse");
+    checkNormalizes("Œuvre", "oeuvre");
+    checkNormalizes("Łódź", "lodz");
+    checkNormalizes("niño", "nino");
+    checkNormalizes("µ", "µ");
+    checkNormalizes("«¿¡»", "");
+
+    // Exactly 8 and 16 letters, one short, one over, and a non-letter at
+    // the last position of a wide chunk
+    checkNormalizes("ABCDEFGH", "abcdefgh");
+    checkNormalizes("ABCDEFG", "abcdefg");
+    checkNormalizes("ABCDEFGHIJKLMNOP", "abcdefghijklmnop");
+    checkNormalizes("ABCDEFGHIJKLMNOPQ", "abcdefghijklmnopq");
+    checkNormalizes("abcdefghijklmno1rest", "abcdefghijklmnorest");
+    checkNormalizes("abcdefghijklmnoérest", "abcdefghijklmnoerest");
+    checkNormalizes("abcdefgé", "abcdefge");
+    checkNormalizes("ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz",
+                    "abcdefghijklmnopqrstuvwxyzabcdefghijklmnopqrstuvwxyz");
+}
+
+// Other scripts, characters past two bytes and malformed UTF-8
+static void testMultibyte() {
+    checkNormalizes("ΑΒΓΔ", "αβγδ");
+    checkNormalizes("Ωμέγα", "ωμέγα");
+    checkNormalizes("ЖИЗНЬ", "жизнь");
+    checkNormalizes("Ạp", "ạp");
+    checkNormalizes("中文", "中文");
+    checkNormalizes("𝔸b", "𝔸b");
+    checkNormalizes("😀abc", "abc");
+    checkNormalizes("e\u0301te", "ete");   // combining acute accent
+    checkNormalizes("€5", "");
+
+    checkNormalizes("a\x80" "b", "ab");                 // lone continuation byte
+    checkNormalizes("\xC0\xAFx", "x");               // overlong "/"
+    checkNormalizes("\xE0\x80\xAFx", "x");           // overlong three-byte
+    checkNormalizes("\xED\xA0\x80z", "z");           // surrogate
+    checkNormalizes("\xF4\x90\x80\x80q", "q");       // above U+10FFFF
+    checkNormalizes("\xF5\xFF\xFEok", "ok");         // never valid
+    checkNormalizes("\xE2\x82", "");                 // cut short at the end
+    checkNormalizes("\xE2\x82" "A", "a");               // cut short by a letter
+    checkNormalizes("\xC3", "");
+    checkNormalizes("abcdefghijklmno\xC3", "abcdefghijklmno");
+    checkNormalizes("abcdefghijklmno\xF0\x9F\x98", "abcdefghijklmno");
+}
+
+// decodeUtf8() lengths: a malformed sequence takes its longest valid
+// prefix, so the byte that broke it starts the next character
+static void testDecodeLengths() {
+    struct Case {
+        const char* bytes;
+        uint32_t codepoint;
+        size_t taken;
+    };
+    const Case cases[] = {
+        {"A", 'A', 1},
+        {"\xC3\xA9", 0xE9, 2},
+        {"\xE2\x82\xAC", 0x20AC, 3},
+        {"\xF0\x9F\x98\x80", 0x1F600, 4},
+        {"\xF4\x8F\xBF\xBF", 0x10FFFF, 4},
+        {"\x80", INVALID_CODEPOINT, 1},
+        {"\xC0\xAF", INVALID_CODEPOINT, 1},
+        {"\xE0\x9F\x80", INVALID_CODEPOINT, 1},
+        {"\xED\xA0\x80", INVALID_CODEPOINT, 1},
+        {"\xE2\x82", INVALID_CODEPOINT, 2},
+        {"\xE2\x82" "A", INVALID_CODEPOINT, 2},
+        {"\xF0\x9F\x98" "A", INVALID_CODEPOINT, 3},
+        {"\xF4\x90\x80\x80", INVALID_CODEPOINT, 1},
+        {"\xFF", INVALID_CODEPOINT, 1},
+    };
+    for (const Case& c : cases) {
+        uint32_t codepoint = 0;
+        size_t taken = decodeUtf8(c.bytes, strlen(c.bytes), 0, codepoint);
+        CHECK(codepoint == c.codepoint);
+        CHECK(taken == c.taken);
+        if (codepoint != c.codepoint || taken != c.taken) {
+            check_detail::fail(__FILE__, __LINE__, "decoding \"" + check_detail::escape(c.bytes) + "\"");
+        }
+    }
+}
+
+// Every byte value alone and after a run of letters long enough for the
+// wide paths, against the reference
+static void testEveryByte() {
+    for (int b = 0; b < 256; ++b) {
+        string single(1, static_cast<char>(b));
+        CHECK_BYTES(normalizeExact(single), referenceNormalize(single), "byte " + to_string(b));
+        string padded = "ABCDEFGHIJKLMNOP" + single + "qrstuvwxyzabcdef";
+        CHECK_BYTES(normalizeExact(padded), referenceNormalize(padded), "byte " + to_string(b) + " in letters");
+    }
+}
+
+// Random strings with long letter runs, so the 16- and 8-byte paths start
+// and stop at every alignment, checked whole and at every offset and length
+static void testRandomAgainstReference(const vector<string>& pieces, unsigned seed) {
+    mt19937 random(seed);
+    for (int round = 0; round < 300; ++round) {
+        string text;
+        while (text.size() < 80) {
+            if (random() % 3 == 0) {
+                size_t run = random() % 24;
+                for (size_t i = 0; i < run; ++i) {
+                    char letter = static_cast<char>('a' + random() % 26);
+                    text += (random() % 4 == 0) ? static_cast<char>(letter - 'a' + 'A') : letter;
+                }
+            } else {
+                text += pieces[random() % pieces.size()];
+            }
+        }
+        for (size_t start = 0; start < 24; ++start) {
+            for (size_t length = 0; start + length <= text.size(); length += 1 + length / 4) {
+                string_view word = string_view(text).substr(start, length);
+                CHECK_BYTES(normalizeExact(word), referenceNormalize(word), "random");
+            }
+        }
+    }
+}
+
+int main() {
+    testKnownWords();
+    testEveryByte();
+    testMultibyte();
+    testDecodeLengths();
+    testRandomAgainstReference({"a", "Z", " ", "'", "-", "0", "@", "[", "`", "{", "é", "É", "ß", "ø", "Ω", "ж", "Ж"}, 3);
+    // Random cuts through three- and four-byte characters and malformed
+    // sequences
+    testRandomAgainstReference({"a", "Q", "é", "Ж", "中", "€", "Ạ", "😀", "𝔸", "\u0301", "\x80", "\xBF", "\xC0\xAF",
+                                "\xE0\x80\xAF", "\xED\xA0\x80", "\xF4\x90\x80\x80", "\xE2\x82", "\xF0\x9F", "\xFF"},
+                               5);
+    return checkResult("normalize_test");
+}
@@ -0,0 +1,156 @@
+#include "check.h"
+#include "segmenter.h"
+#include "test_dictionary.h"
+#include <string>
+#include <vector>
+
+using namespace std;
+
+static const int ENGLISH = 0;
+static const int FRENCH = 1;
+
+static bool buildDictionary(DictionaryImage* image) {
+    return buildTestDictionary(image, {{"English", {"one", "two", "three", "four", "five", "six", "seven"}},
+                                       {"French", {"un", "deux", "trois", "quatre", "cinq", "sept"}}});
+}
+
+static SegmentOptions segmentOptions(size_t window, size_t minSpanTokens) {
+    SegmentOptions options;
+    options.window = window;
+    options.minSpanTokens = minSpanTokens;
+    return options;
+}
+
+// Feeds the text in pieces of `step` bytes (0 for whole)
+static vector<LanguageSpan> segment(const string& text, const DictionaryImage& dictionary,
+                                    const SegmentOptions& options, size_t step = 0) {
+    vector<LanguageSpan> spans;
+    Segmenter segmenter(dictionary, DetectionOptions(), options,
+                        [&spans](const LanguageSpan& span) { spans.push_back(span); });
+    if (step == 0) {
+        segmenter.feed(text);
+    } else {
+        for (size_t from = 0; from < text.size(); from += step) segmenter.feed(string_view(text).substr(from, step));
+    }
+    segmenter.finish();
+    return spans;
+}
+
+static void checkSpan(const LanguageSpan& span, size_t begin, size_t end, int language, size_t tokens) {
+    CHECK(span.begin == begin);
+    CHECK(span.end == end);
+    CHECK(span.language == language);
+    CHECK(span.tokens == tokens);
+}
+
+static bool sameSpans(const vector<LanguageSpan>& a, const vector<LanguageSpan>& b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (a[i].begin != b[i].begin || a[i].end != b[i].end || a[i].language != b[i].language ||
+            a[i].tokens != b[i].tokens) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// English then French, cut where the window first leans French
+static void testTwoSpans() {
+    DictionaryImage dictionary;
+    CHECK(buildDictionary(&dictionary));
+    string text = "one two three, four five. Un deux trois quatre cinq!";
+    vector<LanguageSpan> spans = segment(text, dictionary, segmentOptions(3, 2));
+    CHECK(spans.size() == 2);
+    if (spans.size() != 2) return;
+    checkSpan(spans[0], 0, text.find("five") + 4, ENGLISH, 5);
+    checkSpan(spans[1], text.find("Un"), text.find("cinq") + 4, FRENCH, 5);
+}
+
+// A change of language shorter than minSpanTokens belongs to the span
+// around it; at minSpanTokens or longer it is a span of its own
+static void testBlips() {
+    DictionaryImage dictionary;
+    CHECK(buildDictionary(&dictionary));
+    string text = "one two three un deux four five six seven";
+
+    vector<LanguageSpan> spans = segment(text, dictionary, segmentOptions(1, 3));
+    CHECK(spans.size() == 1);
+    if (spans.size() == 1) checkSpan(spans[0], 0, text.size(), ENGLISH, 9);
+
+    spans = segment(text, dictionary, segmentOptions(1, 2));
+    CHECK(spans.size() == 3);
+    if (spans.size() == 3) {
+        checkSpan(spans[0], 0, text.find(" un"), ENGLISH, 3);
+        checkSpan(spans[1], text.find("un"), text.find(" four"), FRENCH, 2);
+        checkSpan(spans[2], text.find("four"), text.size(), ENGLISH, 4);
+    }
+
+    // A blip at the very end is folded too
+    text = "one two three four un";
+    spans = segment(text, dictionary, segmentOptions(1, 3));
+    CHECK(spans.size() == 1);
+    if (spans.size() == 1) checkSpan(spans[0], 0, text.size(), ENGLISH, 5);
+
+    // Windows and spans of 0 or 1 word: every change is a span of its own
+    for (size_t window : {0, 1}) {
+        for (size_t minSpan : {0, 1}) {
+            spans = segment("one un two", dictionary, segmentOptions(window, minSpan));
+            CHECK(spans.size() == 3);
+            if (spans.size() == 3) {
+                checkSpan(spans[0], 0, 3, ENGLISH, 1);
+                checkSpan(spans[1], 4, 6, FRENCH, 1);
+                checkSpan(spans[2], 7, 10, ENGLISH, 1);
+            }
+        }
+    }
+}
+
+// The last words see a window cut short on the right, the first ones on
+// the left
+static void testShortInput() {
+    DictionaryImage dictionary;
+    CHECK(buildDictionary(&dictionary));
+    SegmentOptions defaults;
+
+    CHECK(segment("", dictionary, defaults).empty());
+    CHECK(segment(" ,. ", dictionary, defaults).empty());
+
+    vector<LanguageSpan> spans = segment("  quatre ", dictionary, defaults);
+    CHECK(spans.size() == 1);
+    if (spans.size() == 1) checkSpan(spans[0], 2, 8, FRENCH, 1);
+
+    spans = segment("xyzzy", dictionary, defaults);
+    CHECK(spans.size() == 1);
+    if (spans.size() == 1) checkSpan(spans[0], 0, 5, -1, 1);
+
+    spans = segment("un deux one", dictionary, defaults);
+    CHECK(spans.size() == 1);
+    if (spans.size() == 1) checkSpan(spans[0], 0, 11, FRENCH, 3);
+}
+
+// Pieces of any size give the spans of the whole text
+static void testChunkedFeed() {
+    DictionaryImage dictionary;
+    CHECK(buildDictionary(&dictionary));
+    string text;
+    for (int i = 0; i < 6; ++i) {
+        text += "one two three four five six seven one two three. ";
+        text += "un deux trois quatre cinq sept un deux trois quatre. ";
+        text += i % 2 ? "six un seven " : "sept, ";
+    }
+    for (const SegmentOptions& options : {SegmentOptions(), segmentOptions(4, 2), segmentOptions(1, 1)}) {
+        vector<LanguageSpan> whole = segment(text, dictionary, options);
+        CHECK(whole.size() > 1);
+        CHECK(whole.front().begin == 0);
+        for (size_t i = 1; i < whole.size(); ++i) CHECK(whole[i].begin > whole[i - 1].end);
+        for (size_t step : {1, 3, 64}) CHECK(sameSpans(segment(text, dictionary, options, step), whole));
+    }
+}
+
+int main() {
+    testTwoSpans();
+    testBlips();
+    testShortInput();
+    testChunkedFeed();
+    return checkResult("segmenter_test");
+}
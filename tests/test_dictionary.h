@@ -0,0 +1,28 @@
+#ifndef TEST_DICTIONARY_H
+#define TEST_DICTIONARY_H
+
+#include <initializer_list>
+#include <string>
+#include <vector>
+#include "dictionary_image.h"
+#include "multi_language_trie.h"
+
+// One language of a test dictionary: its name and every word of it
+struct TestLanguage {
+    std::string name;
+    std::vector<std::string> words;
+};
+
+// Compiles a small in-memory dictionary, languages registered in the order
+// given, so tests need no word list files
+inline bool buildTestDictionary(DictionaryImage* image, std::initializer_list<TestLanguage> languages) {
+    MultiLanguageTrie trie;
+    for (const TestLanguage& language : languages) {
+        int index = trie.addLanguage(language.name);
+        if (index < 0) return false;
+        for (const std::string& word : language.words) trie.insert(word, index);
+    }
+    return image->loadFromBuffer(DictionaryImage::compile(trie));
+}
+
+#endif
@@ -0,0 +1,41 @@
+#include "check.h"
+#include "thread_pool.h"
+#include <atomic>
+
+using namespace std;
+
+// Tasks that submit tasks: wait() must not return until the last nested
+// task has run, however the workers steal from each other
+static void testNestedSubmissions() {
+    ThreadPool pool(4);
+    for (int round = 0; round < 200; ++round) {
+        atomic<int> ran{0};
+        for (int i = 0; i < 8; ++i) {
+            pool.submit([&pool, &ran] {
+                for (int j = 0; j < 8; ++j) {
+                    pool.submit([&ran] { ran.fetch_add(1, memory_order_relaxed); });
+                }
+                ran.fetch_add(1, memory_order_relaxed);
+            });
+        }
+        pool.wait();
+        CHECK(ran.load() == 8 + 8 * 8);
+    }
+}
+
+static void testWaitWithNothingSubmitted() {
+    ThreadPool pool(2);
+    pool.wait();
+    atomic<int> ran{0};
+    pool.submit([&ran] { ++ran; });
+    pool.wait();
+    pool.wait();
+    CHECK(ran.load() == 1);
+    CHECK(pool.threadCount() == 2);
+}
+
+int main() {
+    testNestedSubmissions();
+    testWaitWithNothingSubmitted();
+    return checkResult("thread_pool_test");
+}
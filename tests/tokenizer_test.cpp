@@ -0,0 +1,170 @@
+#include "check.h"
+#include "tokenizer.h"
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Byte by byte with isWordByte(), as offsets into the text
+static vector<pair<size_t, size_t>> referenceTokens(string_view text) {
+    vector<pair<size_t, size_t>> tokens;
+    size_t i = 0;
+    while (i < text.size()) {
+        while (i < text.size() && !Tokenizer::isWordByte(static_cast<unsigned char>(text[i]))) ++i;
+        size_t start = i;
+        while (i < text.size() && Tokenizer::isWordByte(static_cast<unsigned char>(text[i]))) ++i;
+        if (i > start) tokens.emplace_back(start, i - start);
+    }
+    return tokens;
+}
+
+// Tokenizes a copy in a buffer of exactly the text's size, so reading past
+// the end shows up under a sanitizer
+static void checkAgainstReference(string_view original, const string& context) {
+    vector<char> buffer(original.begin(), original.end());
+    string_view text(buffer.data(), buffer.size());
+
+    vector<pair<size_t, size_t>> got;
+    Tokenizer tokenizer(text);
+    string_view token;
+    while (tokenizer.next(token)) {
+        got.emplace_back(static_cast<size_t>(token.data() - text.data()), token.size());
+        CHECK(tokenizer.offset() == got.back().first + token.size());
+    }
+    CHECK(tokenizer.offset() == text.size());
+    if (got != referenceTokens(text)) {
+        check_detail::fail(__FILE__, __LINE__, context + ": tokens of \"" + check_detail::escape(text) + "\" differ");
+    }
+}
+
+static void checkTokens(string_view text, const vector<string>& expected) {
+    vector<string> got;
+    Tokenizer tokenizer(text);
+    string_view token;
+    while (tokenizer.next(token)) got.emplace_back(token);
+    if (got != expected) check_detail::fail(__FILE__, __LINE__, "tokens of \"" + check_detail::escape(text) + "\"");
+}
+
+static void testKnownText() {
+    checkTokens("", {});
+    checkTokens("   \t\n", {});
+    checkTokens("hello", {"hello"});
+    checkTokens("Hello, world!", {"Hello", "world"});
+    checkTokens("aujourd'hui Etats-Unis", {"aujourd'hui", "Etats-Unis"});
+    checkTokens("année 2024: élan", {"année", "2024", "élan"});
+    checkTokens("x\x01y\x7Fz", {"x", "y", "z"});
+    checkTokens("Straße,Ωμέγα;жизнь", {"Straße", "Ωμέγα", "жизнь"});
+
+    // Words and separators either side of the 16-byte boundaries
+    checkTokens("abcdefghijklmno pqrstuvwxyzabcdefg h", {"abcdefghijklmno", "pqrstuvwxyzabcdefg", "h"});
+    checkTokens("               x", {"x"});
+    checkTokens("                x", {"x"});
+    checkTokens("abcdefghijklmnopqrstuvwxyzabcdef", {"abcdefghijklmnopqrstuvwxyzabcdef"});
+    checkTokens("abcdefghijklmnoé", {"abcdefghijklmnoé"});
+}
+
+// Every byte value between words, at each position of a 16-byte chunk
+static void testEveryByte() {
+    for (int b = 0; b < 256; ++b) {
+        for (size_t position = 0; position < 33; ++position) {
+            string text(40, 'a');
+            text[position] = static_cast<char>(b);
+            checkAgainstReference(text, "byte " + to_string(b) + " at " + to_string(position));
+        }
+    }
+}
+
+// Random text of words, separators and multibyte characters, whole and at
+// every offset and length
+static void testRandomAgainstReference() {
+    static const char* const pieces[] = {"a", "Z", "9", "'", "-", " ", "  ", "\t", "\n", ",", ".", "@", "[", "`",
+                                         "{", "/", ":", "é", "ж", "中", "😀", "\x80", "\xFF"};
+    mt19937 random(11);
+    for (int round = 0; round < 300; ++round) {
+        string text;
+        while (text.size() < 70) {
+            if (random() % 3 == 0) {
+                text.append(random() % 20, static_cast<char>('a' + random() % 26));
+            } else {
+                text += pieces[random() % (sizeof(pieces) / sizeof(pieces[0]))];
+            }
+        }
+        for (size_t start = 0; start < 20; ++start) {
+            for (size_t length = 0; start + length <= text.size(); length += 1 + length / 3) {
+                checkAgainstReference(string_view(text).substr(start, length), "random");
+            }
+        }
+    }
+}
+
+// Feeds the text cut into pieces at `cuts` and checks the words against
+// the reference, less runs too long to be words
+static void checkChunks(const string& text, const vector<size_t>& cuts, const string& context) {
+    vector<pair<size_t, size_t>> expected;
+    for (const auto& token : referenceTokens(text)) {
+        if (token.second <= ChunkTokenizer::MAX_WORD_BYTES) expected.push_back(token);
+    }
+
+    vector<pair<size_t, size_t>> got;
+    ChunkTokenizer tokens;
+    string_view word;
+    size_t offset;
+    size_t from = 0;
+    for (size_t cut : cuts) {
+        tokens.feed(string_view(text).substr(from, cut - from));
+        while (tokens.next(word, offset)) {
+            got.emplace_back(offset, word.size());
+            CHECK(text.compare(offset, word.size(), word) == 0);
+        }
+        from = cut;
+    }
+    tokens.feed(string_view(text).substr(from));
+    while (tokens.next(word, offset)) got.emplace_back(offset, word.size());
+    if (tokens.finish(word, offset)) got.emplace_back(offset, word.size());
+    CHECK(tokens.size() == text.size());
+    if (got != expected) check_detail::fail(__FILE__, __LINE__, context + ": words differ");
+}
+
+static void testChunks() {
+    checkChunks("hello world", {}, "whole");
+    checkChunks("", {0, 0}, "empty pieces");
+    for (size_t cut = 0; cut <= 11; ++cut) checkChunks("hello world", {cut}, "cut at " + to_string(cut));
+    checkChunks("abc", {1, 2}, "a word over three pieces");
+    checkChunks("ab, cd", {2, 2, 3}, "an empty piece after a word");
+
+    // Runs either side of the limit, whole and cut into small pieces
+    string limit(ChunkTokenizer::MAX_WORD_BYTES, 'x');
+    for (const string& run : {limit, limit + "y", string(5000, 'z')}) {
+        string text = "before " + run + " after " + run;
+        string context = "run of " + to_string(run.size());
+        checkChunks(text, {}, context);
+        for (size_t step : {1, 7, 100, 300}) {
+            vector<size_t> cuts;
+            for (size_t cut = step; cut < text.size(); cut += step) cuts.push_back(cut);
+            checkChunks(text, cuts, context + " in pieces of " + to_string(step));
+        }
+    }
+
+    // Random text cut at random places
+    mt19937 random(17);
+    for (int round = 0; round < 300; ++round) {
+        string text;
+        while (text.size() < 600) {
+            size_t run = random() % 5 == 0 ? 200 + random() % 100 : random() % 12;
+            text.append(run, static_cast<char>('a' + random() % 26));
+            text += random() % 2 ? " " : ", ";
+        }
+        vector<size_t> cuts;
+        for (size_t cut = random() % 40; cut < text.size(); cut += random() % 80) cuts.push_back(cut);
+        checkChunks(text, cuts, "random");
+    }
+}
+
+int main() {
+    testKnownText();
+    testEveryByte();
+    testRandomAgainstReference();
+    testChunks();
+    return checkResult("tokenizer_test");
+}
@@ -0,0 +1,159 @@
+#include "check.h"
+#include "multi_language_trie.h"
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// The child findChild() should return, found by a plain scan of the keys
+static TrieNodeRef scanChild(const TrieNode* node, unsigned char key) {
+    for (uint16_t i = 0; i < node->childCount; ++i) {
+        if (node->keys()[i] == key) return node->children()[i];
+    }
+    return NO_NODE;
+}
+
+// Grows one node through every capacity, in an order that inserts at the
+// front, middle and back, and checks the sorted keys and the word-at-a-time
+// findChild() against a scan after each insertion
+static void testNodeGrowth() {
+    TrieArena arena;
+    TrieNodeRef node = arena.create();
+
+    vector<int> keys(CHAR_SIZE);
+    for (int i = 0; i < CHAR_SIZE; ++i) keys[i] = i;
+    mt19937 random(1);
+    shuffle(keys.begin(), keys.end(), random);
+
+    vector<TrieNodeRef> childOf(CHAR_SIZE, NO_NODE);
+    for (int key : keys) {
+        TrieNodeRef child = arena.addChild(node, static_cast<unsigned char>(key));
+        CHECK(child != NO_NODE);
+        childOf[key] = child;
+
+        const TrieNode* parent = arena.get(node);
+        CHECK(is_sorted(parent->keys(), parent->keys() + parent->childCount));
+        CHECK(parent->childCount <= parent->capacity);
+        for (int probe = 0; probe < CHAR_SIZE; ++probe) {
+            unsigned char k = static_cast<unsigned char>(probe);
+            CHECK(parent->findChild(k) == scanChild(parent, k));
+            CHECK(parent->findChild(k) == childOf[probe]);
+        }
+    }
+    CHECK(arena.get(node)->childCount == CHAR_SIZE);
+
+    // Adding an existing key returns the same child and creates nothing
+    size_t nodes = arena.nodeCount();
+    CHECK(arena.addChild(node, 'a') == childOf['a']);
+    CHECK(arena.nodeCount() == nodes);
+    for (int key = 0; key < CHAR_SIZE; ++key) {
+        CHECK(arena.get(childOf[key])->value == static_cast<char>(key));
+    }
+}
+
+// Enough nodes to span several arena blocks, each keeping its own value
+// and children after the others grew and moved
+static void testManyBlocks() {
+    TrieArena arena;
+    vector<TrieNodeRef> nodes;
+    for (int i = 0; i < 20000; ++i) nodes.push_back(arena.create(static_cast<char>(i)));
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        for (int k = 0; k < static_cast<int>(i % 5); ++k) arena.addChild(nodes[i], static_cast<unsigned char>('a' + k));
+    }
+    CHECK(arena.memoryUsage() > 64 * 1024);
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        const TrieNode* node = arena.get(nodes[i]);
+        CHECK(node->value == static_cast<char>(i));
+        CHECK(node->childCount == i % 5);
+        for (int k = 0; k < static_cast<int>(i % 5); ++k) {
+            CHECK(node->findChild(static_cast<unsigned char>('a' + k)) != NO_NODE);
+        }
+    }
+}
+
+static string randomWord(mt19937& random) {
+    // Short alphabet so words share prefixes; a few UTF-8 letters and
+    // uppercase ones so normalized keys differ from the words
+    static const char* const pieces[] = {"a", "b", "e", "l", "n", "s", "t", "A", "E", "é", "è", "ß", "ü", "'", "-"};
+    size_t length = 1 + random() % 8;
+    string word;
+    for (size_t i = 0; i < length; ++i) word += pieces[random() % (sizeof(pieces) / sizeof(pieces[0]))];
+    return word;
+}
+
+// insertSorted() from sorted, merged entries builds the same trie as
+// insert() one word at a time
+static void testInsertSortedMatchesInsert() {
+    mt19937 random(7);
+    vector<vector<string>> words(3);
+    for (auto& list : words) {
+        for (int i = 0; i < 3000; ++i) list.push_back(randomWord(random));
+        list.push_back("Éléphant");
+        list.push_back(list.front());   // duplicates merge
+    }
+
+    MultiLanguageTrie byWord;
+    MultiLanguageTrie sorted;
+    for (size_t language = 0; language < words.size(); ++language) {
+        string name = "language" + to_string(language);
+        CHECK(byWord.addLanguage(name) == static_cast<int>(language));
+        CHECK(sorted.addLanguage(name) == static_cast<int>(language));
+
+        vector<TrieEntry> entries;
+        for (const string& word : words[language]) {
+            byWord.insert(word, static_cast<int>(language));
+            MultiLanguageTrie::wordEntries(word, &entries);
+        }
+        MultiLanguageTrie::sortEntries(&entries);
+        for (size_t i = 1; i < entries.size(); ++i) CHECK(entries[i - 1].key < entries[i].key);
+        sorted.insertSorted(entries, static_cast<int>(language));
+    }
+    CHECK(byWord.nodeCount() == sorted.nodeCount());
+
+    // Words, their prefixes, normalized forms and strangers
+    vector<string> probes;
+    for (const auto& list : words) {
+        for (const string& word : list) {
+            probes.push_back(word);
+            probes.push_back(word.substr(0, word.size() / 2));
+            probes.push_back(normalizeWord(word));
+        }
+    }
+    for (int i = 0; i < 2000; ++i) probes.push_back(randomWord(random));
+
+    for (const string& probe : probes) {
+        LanguageMatch a = byWord.lookup(probe);
+        LanguageMatch b = sorted.lookup(probe);
+        CHECK(a.exact == b.exact);
+        CHECK(a.normalized == b.normalized);
+    }
+}
+
+static void testMatchScores() {
+    MultiLanguageTrie trie;
+    int french = trie.addLanguage("French");
+    int german = trie.addLanguage("German");
+    trie.insert("Éléphant", french);
+    trie.insert("straße", german);
+    trie.insert("le", french);
+
+    CHECK(trie.getMatchScore("Éléphant", french) == 2);
+    CHECK(trie.getMatchScore("elephant", french) == 1);
+    CHECK(trie.getMatchScore("ELEPHANT", french) == 1);
+    CHECK(trie.getMatchScore("elephant", german) == 0);
+    CHECK(trie.getMatchScore("strasse", german) == 1);
+    CHECK(trie.getMatchScore("le", french) == 2);
+    CHECK(trie.getMatchScore("l", french) == 0);
+    CHECK(trie.getMatchScore("les", french) == 0);
+    CHECK(trie.lookup("le").exact == (LanguageMask(1) << french));
+}
+
+int main() {
+    testNodeGrowth();
+    testManyBlocks();
+    testInsertSortedMatchesInsert();
+    testMatchScores();
+    return checkResult("trie_test");
+}
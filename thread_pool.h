@@ -0,0 +1,145 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed-size work-stealing thread pool.
+//
+// Every worker owns a deque. Tasks submitted from outside the pool are dealt
+// round-robin across the deques; tasks submitted by a worker go to its own
+// deque. A worker pops from the back of its own deque (newest first, good
+// locality) and, when that is empty, steals from the front of the others'
+// (oldest first), so uneven task sizes still keep every core busy.
+class ThreadPool {
+public:
+    using Task = std::function<void()>;
+
+    // Starts `threads` workers, or one per hardware thread when 0
+    explicit ThreadPool(size_t threads = 0) {
+        if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+        for (size_t i = 0; i < threads; ++i) queues.emplace_back(new WorkerQueue());
+        for (size_t i = 0; i < threads; ++i) workers.emplace_back([this, i] { run(i); });
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Finishes every queued task, then joins the workers
+    ~ThreadPool() {
+        wait();
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            stopping = true;
+        }
+        wakeWorkers.notify_all();
+        for (std::thread& worker : workers) worker.join();
+    }
+
+    void submit(Task task) {
+        size_t target = (currentPool == this)
+            ? currentWorker
+            : nextQueue.fetch_add(1, std::memory_order_relaxed) % queues.size();
+        // Counted before it is visible: a worker may run and finish the
+        // task as soon as it is pushed, and wait() must not see zero first
+        unfinished.fetch_add(1, std::memory_order_release);
+        {
+            std::lock_guard<std::mutex> lock(queues[target]->mutex);
+            queues[target]->tasks.push_back(std::move(task));
+        }
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            ++queued;
+        }
+        wakeWorkers.notify_one();
+    }
+
+    // Blocks until every submitted task has finished
+    void wait() {
+        std::unique_lock<std::mutex> lock(doneMutex);
+        allDone.wait(lock, [this] { return unfinished.load(std::memory_order_acquire) == 0; });
+    }
+
+    size_t threadCount() const {
+        return workers.size();
+    }
+
+private:
+    struct WorkerQueue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    bool popOwn(size_t index, Task& task) {
+        WorkerQueue& queue = *queues[index];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.tasks.empty()) return false;
+        task = std::move(queue.tasks.back());
+        queue.tasks.pop_back();
+        return true;
+    }
+
+    bool steal(size_t thief, Task& task) {
+        for (size_t offset = 1; offset < queues.size(); ++offset) {
+            WorkerQueue& victim = *queues[(thief + offset) % queues.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (victim.tasks.empty()) continue;
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            return true;
+        }
+        return false;
+    }
+
+    void run(size_t index) {
+        currentPool = this;
+        currentWorker = index;
+
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(sleepMutex);
+                wakeWorkers.wait(lock, [this] { return stopping || queued > 0; });
+                if (queued == 0) return;  // stopping with nothing left to do
+                --queued;
+            }
+
+            // Each reservation matches a task already pushed, but another
+            // worker may take the one we were heading for; rescan until we
+            // get one
+            Task task;
+            while (!popOwn(index, task) && !steal(index, task)) std::this_thread::yield();
+
+            task();
+
+            if (unfinished.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                std::lock_guard<std::mutex> lock(doneMutex);
+                allDone.notify_all();
+            }
+        }
+    }
+
+    std::vector<std::unique_ptr<WorkerQueue>> queues;
+    std::vector<std::thread> workers;
+    std::atomic<size_t> nextQueue{0};
+    std::atomic<size_t> unfinished{0};
+
+    std::mutex sleepMutex;
+    std::condition_variable wakeWorkers;
+    size_t queued = 0;
+    bool stopping = false;
+
+    std::mutex doneMutex;
+    std::condition_variable allDone;
+
+    static inline thread_local ThreadPool* currentPool = nullptr;
+    static inline thread_local size_t currentWorker = 0;
+};
+
+#endif
@@ -0,0 +1,189 @@
+#ifndef TOKENIZER_H
+#define TOKENIZER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// LANGWITCH_NO_SIMD keeps to the byte-at-a-time scan (see normalize.h)
+#if defined(__SSE2__) && !defined(LANGWITCH_NO_SIMD)
+#include <emmintrin.h>
+#endif
+
+// Splits UTF-8 text into words without copying: tokens are string_views into
+// the original input.
+//
+// Word bytes are ASCII letters and digits, the apostrophe and hyphen (which
+// occur inside dictionary words such as "aujourd'hui" or "Etats-Unis") and
+// every byte >= 0x80, so multi-byte characters are never split. All other
+// bytes, i.e. ASCII whitespace, control characters and punctuation, separate
+// words. With SSE2 the input is classified 16 bytes at a time.
+class Tokenizer {
+public:
+    explicit Tokenizer(std::string_view text) : text(text), position(0) {}
+
+    // Stores the next word in `token` and returns true, or returns false at
+    // the end of the input
+    bool next(std::string_view& token) {
+        size_t start = find(position, true);
+        if (start >= text.size()) {
+            position = text.size();
+            return false;
+        }
+        size_t end = find(start, false);
+        token = text.substr(start, end - start);
+        position = end;
+        return true;
+    }
+
+    // Byte offset just past the last token returned
+    size_t offset() const {
+        return position;
+    }
+
+    static bool isWordByte(unsigned char c) {
+        if (c >= 0x80) return true;
+        unsigned char lower = c | 0x20;
+        return (lower >= 'a' && lower <= 'z') || (c >= '0' && c <= '9') || c == '\'' || c == '-';
+    }
+
+private:
+    // Offset of the first byte at or after `from` that is (or, when
+    // `wordByte` is false, is not) a word byte
+    size_t find(size_t from, bool wordByte) const {
+        const char* data = text.data();
+        size_t size = text.size();
+        size_t i = from;
+#if defined(__SSE2__) && !defined(LANGWITCH_NO_SIMD)
+        while (i + 16 <= size) {
+            uint32_t mask = wordMask16(data + i);
+            if (!wordByte) mask = ~mask & 0xFFFF;
+            if (mask) return i + __builtin_ctz(mask);
+            i += 16;
+        }
+#endif
+        while (i < size && isWordByte(static_cast<unsigned char>(data[i])) != wordByte) ++i;
+        return i;
+    }
+
+#if defined(__SSE2__) && !defined(LANGWITCH_NO_SIMD)
+    // Bit i is set when byte i is a word byte
+    static uint32_t wordMask16(const char* p) {
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        // Bytes >= 0x80 are negative as signed chars
+        __m128i high = _mm_cmplt_epi8(bytes, _mm_setzero_si128());
+        __m128i lower = _mm_or_si128(bytes, _mm_set1_epi8(0x20));
+        __m128i letter = _mm_and_si128(_mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)),
+                                       _mm_cmplt_epi8(lower, _mm_set1_epi8('z' + 1)));
+        __m128i digit = _mm_and_si128(_mm_cmpgt_epi8(bytes, _mm_set1_epi8('0' - 1)),
+                                      _mm_cmplt_epi8(bytes, _mm_set1_epi8('9' + 1)));
+        __m128i joiner = _mm_or_si128(_mm_cmpeq_epi8(bytes, _mm_set1_epi8('\'')),
+                                      _mm_cmpeq_epi8(bytes, _mm_set1_epi8('-')));
+        __m128i word = _mm_or_si128(_mm_or_si128(high, letter), _mm_or_si128(digit, joiner));
+        return static_cast<uint32_t>(_mm_movemask_epi8(word));
+    }
+#endif
+
+    std::string_view text;
+    size_t position;
+};
+
+// Splits input that arrives in pieces (a stream, a file read in chunks) into
+// words, joining a word that two pieces cut in half, and gives each word's
+// offset in the whole input.
+//
+// The trailing word of a piece is held back until the next piece shows
+// whether it goes on. A run of word bytes longer than MAX_WORD_BYTES (a
+// base64 blob, a minified line) is no word and is skipped whole, wherever
+// the pieces cut it, so the held-back bytes stay within that bound.
+class ChunkTokenizer {
+public:
+    static const size_t MAX_WORD_BYTES = 256;
+
+    ChunkTokenizer() : tokens(std::string_view()) {}
+
+    // Starts on the next piece, which must outlive the next() calls that
+    // read its words
+    void feed(std::string_view piece) {
+        chunk = piece;
+        chunkOffset = fed;
+        fed += piece.size();
+        joinedReady = false;
+
+        // Finish the word left over from the previous piece
+        size_t start = 0;
+        if (!carry.empty() || skipping) {
+            while (start < piece.size() && Tokenizer::isWordByte(static_cast<unsigned char>(piece[start]))) ++start;
+            if (!skipping && carry.size() + start <= MAX_WORD_BYTES) {
+                carry.append(piece.data(), start);
+            } else {
+                skipping = true;
+                carry.clear();
+            }
+            if (start == piece.size()) {
+                tokens = Tokenizer(std::string_view());
+                return;
+            }
+            skipping = false;
+            joined.swap(carry);
+            joinedOffset = carryOffset;
+            joinedReady = !joined.empty();
+        }
+
+        // Hold back a trailing word that may continue in the next piece
+        size_t cut = piece.size();
+        while (cut > start && Tokenizer::isWordByte(static_cast<unsigned char>(piece[cut - 1]))) --cut;
+        tokens = Tokenizer(piece.substr(start, cut - start));
+        skipping = piece.size() - cut > MAX_WORD_BYTES;
+        carry.assign(piece.data() + cut, skipping ? 0 : piece.size() - cut);
+        carryOffset = chunkOffset + cut;
+    }
+
+    // Stores the next complete word of the current piece and its input
+    // offset, or returns false when the piece has no more
+    bool next(std::string_view& word, size_t& offset) {
+        if (joinedReady) {
+            joinedReady = false;
+            word = joined;
+            offset = joinedOffset;
+            return true;
+        }
+        while (tokens.next(word)) {
+            if (word.size() > MAX_WORD_BYTES) continue;
+            offset = chunkOffset + static_cast<size_t>(word.data() - chunk.data());
+            return true;
+        }
+        return false;
+    }
+
+    // At the end of the input, stores the word still held back, if any
+    bool finish(std::string_view& word, size_t& offset) {
+        tokens = Tokenizer(std::string_view());
+        joinedReady = false;
+        skipping = false;
+        if (carry.empty()) return false;
+        joined.swap(carry);
+        carry.clear();
+        word = joined;
+        offset = carryOffset;
+        return true;
+    }
+
+    // Bytes fed so far
+    size_t size() const { return fed; }
+
+private:
+    Tokenizer tokens;             // the current piece, less the ends
+    std::string_view chunk;
+    size_t chunkOffset = 0;       // input offset of `chunk`
+    size_t fed = 0;
+    std::string carry;            // trailing word of the current piece
+    size_t carryOffset = 0;
+    std::string joined;           // carry completed by the current piece
+    size_t joinedOffset = 0;
+    bool joinedReady = false;     // `joined` not yet returned by next()
+    bool skipping = false;        // inside a run longer than MAX_WORD_BYTES
+};
+
+#endif
@@ -1,33 +1,214 @@
 #ifndef TRIE_NODE_H
 #define TRIE_NODE_H
 
-// ASCII (0–127)
-const int CHAR_SIZE = 128;
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
 
+// Keys are bytes: ASCII, or the UTF-8 bytes of other characters
+const int CHAR_SIZE = 256;
+
+// One bit per language; bit i is set when language i has the word
+using LanguageMask = uint64_t;
+const int MAX_LANGUAGES = 64;
+
+// A node's position in its TrieArena; 0 is never a node and means "none"
+using TrieNodeRef = uint32_t;
+const TrieNodeRef NO_NODE = 0;
+
+// A trie node and its child table live in one variable-sized record:
+//
+//     [ header | unsigned char keys[capacity, padded to 8] | TrieNodeRef children[capacity] ]
+//
+// Keys are kept sorted. Most nodes have one or two children, so a node costs
+// a few dozen bytes instead of a full CHAR_SIZE table, and the keys sit in
+// the same cache line as the header. Records are allocated from a TrieArena
+// and children are 32-bit references into it rather than pointers.
 struct TrieNode {
+    LanguageMask exactMask;       // languages where this is the end of a word
+    LanguageMask normalizedMask;  // languages where this ends a normalized word
     char value;
-    bool isEndOfWord;
-    bool isNormalizedWord;
+    uint16_t childCount;
+    uint16_t capacity;
 
-    TrieNode* children[CHAR_SIZE];  // children nodes
+    unsigned char* keys() { return reinterpret_cast<unsigned char*>(this + 1); }
+    const unsigned char* keys() const { return reinterpret_cast<const unsigned char*>(this + 1); }
+    TrieNodeRef* children() { return reinterpret_cast<TrieNodeRef*>(keys() + paddedKeyBytes(capacity)); }
+    const TrieNodeRef* children() const {
+        return reinterpret_cast<const TrieNodeRef*>(keys() + paddedKeyBytes(capacity));
+    }
 
-    // Constructor
-    TrieNode(char val = '\0') {
-        isEndOfWord = false;
-        isNormalizedWord = false;
-        for (int i = 0; i < CHAR_SIZE; i++) children[i] = nullptr;
+    // Returns the child for the given key, or NO_NODE. Compares eight keys
+    // per step so wide nodes near the root don't pay a mispredicted branch
+    // per key.
+    TrieNodeRef findChild(unsigned char key) const {
+        const unsigned char* k = keys();
+        for (uint16_t base = 0; base < childCount; base += 8) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+            uint64_t chunk;
+            std::memcpy(&chunk, k + base, sizeof(chunk));
+            uint64_t x = chunk ^ (0x0101010101010101ULL * key);
+            uint64_t found = (x - 0x0101010101010101ULL) & ~x & 0x8080808080808080ULL;
+            if (found) {
+                uint16_t i = base + (__builtin_ctzll(found) >> 3);
+                return i < childCount ? children()[i] : NO_NODE;
+            }
+#else
+            for (uint16_t i = base; i < base + 8 && i < childCount; ++i)
+                if (k[i] == key) return children()[i];
+#endif
+        }
+        return NO_NODE;
+    }
+
+    static size_t paddedKeyBytes(uint16_t capacity) {
+        return (capacity + 7u) & ~size_t(7);
     }
 
+    // Bytes of a record with room for `capacity` children
+    static size_t recordSize(uint16_t capacity) {
+        return sizeof(TrieNode) + paddedKeyBytes(capacity) + capacity * sizeof(TrieNodeRef);
+    }
+};
 
-    // Destructor
-    ~TrieNode() {
-        for (int i = 0; i < CHAR_SIZE; ++i) {
-            if (children[i]) {
-                delete children[i];
-                children[i] = nullptr;
+static_assert(sizeof(TrieNode) % 8 == 0,
+              "keys and child references must start aligned right after the header");
+
+// Owns the nodes of one trie.
+//
+// Records are carved from 64 KiB blocks with a bump pointer and addressed by
+// (block, 8-byte unit) packed into a TrieNodeRef. Blocks never move, so a
+// node's address is stable until it grows. A node that outgrows its record
+// moves to a bigger one and the old record goes on a free list for its
+// capacity, where the next node growing to that size picks it up. Nothing
+// is freed node by node: destroying the arena releases a handful of blocks.
+class TrieArena {
+public:
+    TrieArena() {
+        used = 1;   // unit 0 of block 0 stays empty so no node is NO_NODE
+        blocks.emplace_back(new uint64_t[BLOCK_UNITS]);
+        for (TrieNodeRef& head : freeLists) head = NO_NODE;
+    }
+
+    TrieArena(const TrieArena&) = delete;
+    TrieArena& operator=(const TrieArena&) = delete;
+
+    TrieNode* get(TrieNodeRef ref) {
+        return reinterpret_cast<TrieNode*>(blocks[ref >> BLOCK_BITS].get() + (ref & (BLOCK_UNITS - 1)));
+    }
+    const TrieNode* get(TrieNodeRef ref) const {
+        return reinterpret_cast<const TrieNode*>(blocks[ref >> BLOCK_BITS].get() + (ref & (BLOCK_UNITS - 1)));
+    }
+
+    TrieNodeRef create(char val = '\0') {
+        ++nodes;
+        return allocate(val, 0);
+    }
+
+    // Returns the slot holding the child of `node` for the given key, creating
+    // the child if needed. May move `node` to a larger record, so it is taken
+    // by reference; the returned slot stays valid until `node` grows.
+    TrieNodeRef& addChild(TrieNodeRef& node, unsigned char key) {
+        TrieNode* parent = get(node);
+        uint16_t pos = 0;
+        const unsigned char* k = parent->keys();
+        if (parent->childCount && k[parent->childCount - 1] < key) {
+            pos = parent->childCount;   // sorted input appends, skip the scan
+        } else {
+            while (pos < parent->childCount && k[pos] < key) ++pos;
+            if (pos < parent->childCount && k[pos] == key) return parent->children()[pos];
+        }
+
+        // Create the child first: allocating may start a new block, which
+        // the parent pointer survives, but growing must come last
+        TrieNodeRef child = create(static_cast<char>(key));
+        if (parent->childCount == parent->capacity) {
+            node = grow(node);
+            parent = get(node);
+        }
+
+        TrieNodeRef* c = parent->children();
+        unsigned char* ks = parent->keys();
+        uint16_t tail = parent->childCount - pos;
+        std::memmove(c + pos + 1, c + pos, tail * sizeof(TrieNodeRef));
+        std::memmove(ks + pos + 1, ks + pos, tail);
+
+        c[pos] = child;
+        ks[pos] = key;
+        ++parent->childCount;
+        return c[pos];
+    }
+
+    // Nodes created so far
+    size_t nodeCount() const { return nodes; }
+
+    // Bytes handed out to records, including ones waiting on a free list
+    size_t memoryUsage() const {
+        return ((blocks.size() - 1) * BLOCK_UNITS + used) * sizeof(uint64_t);
+    }
+
+private:
+    static const unsigned BLOCK_BITS = 13;
+    static const uint32_t BLOCK_UNITS = 1u << BLOCK_BITS;   // 8-byte units per block
+    static const int CAPACITY_CLASSES = 10;                 // 0, 1, 2, 4 ... CHAR_SIZE
+
+    static int capacityClass(uint16_t capacity) {
+        return capacity ? 1 + __builtin_ctz(capacity) : 0;
+    }
+
+    static uint32_t recordUnits(uint16_t capacity) {
+        return static_cast<uint32_t>((TrieNode::recordSize(capacity) + 7) / 8);
+    }
+
+    TrieNodeRef allocate(char val, uint16_t capacity) {
+        TrieNodeRef ref = freeLists[capacityClass(capacity)];
+        if (ref != NO_NODE) {
+            std::memcpy(&freeLists[capacityClass(capacity)], get(ref), sizeof(TrieNodeRef));
+        } else {
+            uint32_t units = recordUnits(capacity);
+            if (used + units > BLOCK_UNITS) {
+                blocks.emplace_back(new uint64_t[BLOCK_UNITS]);
+                used = 0;
             }
+            ref = static_cast<TrieNodeRef>(((blocks.size() - 1) << BLOCK_BITS) | used);
+            used += units;
         }
+
+        TrieNode* node = get(ref);
+        node->exactMask = 0;
+        node->normalizedMask = 0;
+        node->value = val;
+        node->childCount = 0;
+        node->capacity = capacity;
+        std::memset(node->keys(), 0, TrieNode::paddedKeyBytes(capacity));
+        return ref;
     }
+
+    TrieNodeRef grow(TrieNodeRef ref) {
+        TrieNode* node = get(ref);
+        uint16_t newCapacity = node->capacity ? node->capacity * 2 : 1;
+        if (newCapacity > CHAR_SIZE) newCapacity = CHAR_SIZE;
+
+        TrieNodeRef biggerRef = allocate(node->value, newCapacity);
+        TrieNode* bigger = get(biggerRef);
+        bigger->exactMask = node->exactMask;
+        bigger->normalizedMask = node->normalizedMask;
+        bigger->childCount = node->childCount;
+        std::memcpy(bigger->keys(), node->keys(), node->childCount);
+        std::memcpy(bigger->children(), node->children(), node->childCount * sizeof(TrieNodeRef));
+
+        // The old record heads the free list for its size
+        int sizeClass = capacityClass(node->capacity);
+        std::memcpy(node, &freeLists[sizeClass], sizeof(TrieNodeRef));
+        freeLists[sizeClass] = ref;
+        return biggerRef;
+    }
+
+    std::vector<std::unique_ptr<uint64_t[]>> blocks;
+    uint32_t used;                             // units taken in the last block
+    TrieNodeRef freeLists[CAPACITY_CLASSES];   // recycled records by capacity
+    size_t nodes = 0;
 };
 
 #endif
@@ -0,0 +1,139 @@
+#ifndef WORD_CACHE_H
+#define WORD_CACHE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string_view>
+#include "trie_node.h"
+
+// How one token matched the dictionary
+struct WordMatch {
+    enum Kind : uint8_t { NONE, EXACT, FUZZY };
+
+    LanguageMask languages = 0;
+    Kind kind = NONE;
+    uint8_t distance = 0;   // edits of a FUZZY match
+};
+
+// Fixed-size cache from token bytes to their WordMatch, shared by any number
+// of detection threads without a lock.
+//
+// Each token hashes to one slot (a later token with the same hash evicts it).
+// Slots are seqlocks: a writer makes the sequence number odd, stores the
+// entry and makes it even again; a reader copies the entry and accepts it
+// only if the sequence number was even and unchanged around the copy. Readers
+// never write shared memory, and a writer that finds a slot busy simply skips
+// the insert. Tokens longer than MAX_KEY bytes are not cached.
+//
+// A cached result depends on the dictionary and on maxEditDistance, so use a
+// separate cache for each combination.
+class WordCache {
+public:
+    static const size_t MAX_KEY = 24;
+
+    // `slots` is rounded up to a power of two
+    explicit WordCache(size_t slots = 1 << 16) {
+        size_t count = 1;
+        while (count < slots) count <<= 1;
+        mask = count - 1;
+        table.reset(new Slot[count]);
+    }
+
+    WordCache(const WordCache&) = delete;
+    WordCache& operator=(const WordCache&) = delete;
+
+    bool find(std::string_view token, WordMatch& match) const {
+        if (token.empty() || token.size() > MAX_KEY) return false;
+        uint64_t key[3];
+        pack(token, key);
+        const Slot& slot = table[hash(key, token.size()) & mask];
+
+        uint32_t before = slot.sequence.load(std::memory_order_acquire);
+        if (before & 1) return false;
+        uint32_t meta = slot.meta.load(std::memory_order_relaxed);
+        bool same = slot.key[0].load(std::memory_order_relaxed) == key[0] &&
+                    slot.key[1].load(std::memory_order_relaxed) == key[1] &&
+                    slot.key[2].load(std::memory_order_relaxed) == key[2];
+        LanguageMask languages = slot.languages.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.sequence.load(std::memory_order_relaxed) != before) return false;
+
+        if (!same || (meta & 0xFF) != token.size()) return false;
+        match.languages = languages;
+        match.kind = static_cast<WordMatch::Kind>((meta >> 8) & 0xFF);
+        match.distance = static_cast<uint8_t>(meta >> 16);
+        return true;
+    }
+
+    void insert(std::string_view token, const WordMatch& match) {
+        if (token.empty() || token.size() > MAX_KEY) return;
+        uint64_t key[3];
+        pack(token, key);
+        Slot& slot = table[hash(key, token.size()) & mask];
+
+        uint32_t sequence = slot.sequence.load(std::memory_order_relaxed);
+        if ((sequence & 1) ||
+            !slot.sequence.compare_exchange_strong(sequence, sequence + 1, std::memory_order_acquire)) {
+            return;  // another thread is writing this slot
+        }
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.meta.store(static_cast<uint32_t>(token.size()) | (uint32_t(match.kind) << 8) |
+                            (uint32_t(match.distance) << 16),
+                        std::memory_order_relaxed);
+        for (int i = 0; i < 3; ++i) slot.key[i].store(key[i], std::memory_order_relaxed);
+        slot.languages.store(match.languages, std::memory_order_relaxed);
+        slot.sequence.store(sequence + 2, std::memory_order_release);
+    }
+
+    // Detectors count hits and misses locally and add them here once per
+    // document, so the counters are not contended per token
+    void recordLookups(uint64_t hitCount, uint64_t missCount) {
+        hitTotal.fetch_add(hitCount, std::memory_order_relaxed);
+        missTotal.fetch_add(missCount, std::memory_order_relaxed);
+    }
+
+    uint64_t hits() const { return hitTotal.load(std::memory_order_relaxed); }
+    uint64_t misses() const { return missTotal.load(std::memory_order_relaxed); }
+
+    double hitRate() const {
+        uint64_t total = hits() + misses();
+        return total ? static_cast<double>(hits()) / total : 0.0;
+    }
+
+    size_t capacity() const { return mask + 1; }
+    size_t memoryUsage() const { return capacity() * sizeof(Slot); }
+
+private:
+    struct alignas(64) Slot {
+        std::atomic<uint32_t> sequence{0};
+        // Key length | kind << 8 | distance << 16; length 0 is empty
+        std::atomic<uint32_t> meta{0};
+        std::atomic<uint64_t> key[3] = {};
+        std::atomic<LanguageMask> languages{0};
+    };
+
+    static void pack(std::string_view token, uint64_t key[3]) {
+        key[0] = key[1] = key[2] = 0;
+        std::memcpy(key, token.data(), token.size());
+    }
+
+    static uint64_t hash(const uint64_t key[3], size_t length) {
+        uint64_t h = length * 0x9E3779B97F4A7C15ULL;
+        for (int i = 0; i < 3; ++i) {
+            h ^= key[i];
+            h *= 0xBF58476D1CE4E5B9ULL;
+            h ^= h >> 31;
+        }
+        return h;
+    }
+
+    std::unique_ptr<Slot[]> table;
+    size_t mask;
+    std::atomic<uint64_t> hitTotal{0};
+    std::atomic<uint64_t> missTotal{0};
+};
+
+#endif